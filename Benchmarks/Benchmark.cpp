@@ -0,0 +1,309 @@
+// Standard C++ headers
+#include<iostream>
+#include<fstream>
+#include<sstream>
+#include<chrono>
+#include<cstring>
+#include<sys/resource.h>
+
+// POSIX headers for running benchmarks in child processes, link() is renamed since SEB uses link for a pair of reference points.
+#define link posix_link
+#include<sys/wait.h>
+#include<unistd.h>
+#undef link
+
+// Include SEB functionality
+#include "SEB.hpp"
+
+/*
+
+    Benchmarks of SEB, written as JSON such that the performance can be tracked across releases.
+
+        derive     Time to build and derive the form factor, and the size of the expression, for stars with N arms,
+                   micelles with N grafted polymers, dendrimers with functionality f and g generations,
+                   and chains of N diblock copolymer stars (see Star.cpp, Micelle.cpp, Dendrimer.cpp and DiBlockStarChain.cpp).
+        findpath   Paths found per second between the tips of a dendrimer.
+        evaluate   Time per q value for evaluating the form factor of each sub-unit type, including the
+                   numerical integrals of SolidCylinder and ThinDisk.
+
+    Each benchmark runs in a child process, and its result includes the peak memory (maximum resident set size) of
+    that process only, i.e. of the benchmark and the small footprint of the program when it was forked. Derivations include
+    the statistics collected by World (see DerivationStatistics in World.hpp) and the complexity of the expression,
+    and evaluations the time per q value when compiled by Evaluator, and as estimated by World::Complexity.
+
+    Usage:   Benchmark [output.json] [quick]
+
+    writes bench.json by default. With quick the smallest sizes only are run, e.g. as a smoke test.
+    The derivation of the largest star chain is also traced, and written to trace.json (see World::WriteTrace).
+
+*/
+
+double Seconds(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+}
+
+// Number of nodes in an expression tree
+long Size(const ex& e)
+{
+    long n = 0;
+    for (auto it = e.preorder_begin(); it != e.preorder_end(); ++it) n++;
+    return n;
+}
+
+// Results as JSON objects, one per benchmark.
+vector<string> results;
+
+// Adds a result, the peak memory and closing brace are added by Isolated when the benchmark has finished.
+void Report(string benchmark, string parameters, string values)
+{
+    ostringstream os;
+    os << "    { \"benchmark\": \"" << benchmark << "\", \"parameters\": { " << parameters << " }, " << values;
+    results.push_back(os.str());
+}
+
+/*  Runs a benchmark in a child process, such that the peak memory reported is that of the benchmark alone rather
+    than of all benchmarks run so far. The results reported by the child are sent back through a pipe, one per line,
+    and completed with the maximum resident set size of the child in kB.
+*/
+void Isolated(const std::function<void()>& benchmark)
+{
+    int fd[2];
+    if (pipe(fd) != 0) throw SEBException("Could not create pipe", "void Isolated(..)");
+
+    cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) throw SEBException("Could not fork benchmark", "void Isolated(..)");
+
+    if (pid == 0)
+      {
+        close(fd[0]);
+        int status = 0;
+        results.clear();
+        try { benchmark(); }
+        catch (const SEBException e)
+          {
+            std::cout << e;
+            status = 1;
+          }
+
+        string out;
+        for (auto& r : results) out += r+"\n";
+        for (size_t done = 0; done < out.size(); )
+          {
+            ssize_t n = write(fd[1], out.data()+done, out.size()-done);
+            if (n <= 0) { status = 1; break; }
+            done += n;
+          }
+        close(fd[1]);
+        cout.flush();
+        _exit(status);
+      }
+
+    close(fd[1]);
+    string in;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd[0], buffer, sizeof(buffer))) > 0) in.append(buffer, n);
+    close(fd[0]);
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        throw SEBException("Benchmark failed", "void Isolated(..)");
+#ifdef __APPLE__
+    long peak = usage.ru_maxrss/1024;     // bytes on Mac
+#else
+    long peak = usage.ru_maxrss;
+#endif
+
+    istringstream is(in);
+    string line;
+    while (getline(is, line))
+      {
+        results.push_back(line+", \"peakmemory_kb\": "+to_string(peak)+" }");
+        cout << results.back() << "\n";
+      }
+}
+
+// Build a structure with build(w), derive its form factor and report.
+void Derive(string benchmark, string parameters, string name, const std::function<void(World&)>& build)
+{
+    World w("bench");
+
+    auto t0 = chrono::steady_clock::now();
+    build(w);
+    double tbuild = Seconds(t0);
+
+    w.setStatistics();
+    t0 = chrono::steady_clock::now();
+    ex F = w.FormFactor(name);
+    double tderive = Seconds(t0);
+
+    ostringstream os;
+    os << "\"build\": " << tbuild << ", \"derive\": " << tderive << ", \"size\": " << Size(F) << ", \"stats\": " << w.Stats().JSON()
+       << ", \"complexity\": " << w.Complexity(F).JSON();
+    Report(benchmark, parameters, os.str());
+}
+
+void Star(World& w, int N)
+{
+    GraphID g = w.Add(new Point(), "p");
+    for (int i=0; i<N; i++)
+         w.Link<GaussianPolymer>("p"+to_string(i)+".end1", "p.point", "poly");
+    w.Add(g, "star");
+}
+
+void Micelle(World& w, int N)
+{
+    GraphID g = w.Add(new SolidSphere(), "sphere");
+    for (int i=0; i<N; i++)
+         w.Link<GaussianPolymer>("poly"+to_string(i)+".end1", "sphere.surface#r"+to_string(i), "poly");
+    w.Add(g, "micelle");
+}
+
+// Adds g generations of branches to polymer name, and the free ends to tips.
+void AddBranches(World& w, int g, int f, string name, vector<string>& tips)
+{
+    if (g==0)
+      {
+         tips.push_back(name+".end2");
+         return;
+      }
+    for (int i=1; i<f; i++)
+      {
+         w.Link<GaussianPolymer>(name+to_string(i)+".end1", name+".end2", "poly");
+         AddBranches(w, g-1, f, name+to_string(i), tips);
+      }
+}
+
+void Dendrimer(World& w, int f, int g, vector<string>& tips)
+{
+    GraphID d = w.Add<GaussianPolymer>("poly0", "poly");
+    for (int i=1; i<f; i++)
+         w.Link<GaussianPolymer>("poly"+to_string(i)+".end1", "poly0.end1", "poly");
+    for (int i=0; i<f; i++)
+         AddBranches(w, g-1, f, "poly"+to_string(i), tips);
+    w.Add(d, "dendrimer");
+}
+
+void StarChain(World& w, int N)
+{
+    GraphID diblock = w.Add<GaussianPolymer>("polyA");
+    w.Link<GaussianPolymer>("polyB.end1", "polyA.end2");
+
+    GraphID star = w.Add(diblock, "diblock1");
+    for (int i=2; i<=4; i++)
+         w.Link(diblock, "diblock"+to_string(i)+":polyA.end1", "diblock1:polyA.end1");
+
+    GraphID chain = w.Add(star, "star1");
+    for (int i=2; i<=N; i++)
+         w.Link(star, "star"+to_string(i)+":diblock1:polyB.end2", "star"+to_string(i-1)+":diblock3:polyB.end2");
+    w.Add(chain, "chain");
+}
+
+int main(int argc, char** argv)
+{
+ try{
+    string output = argc>1 ? argv[1] : "bench.json";
+    bool quick = argc>2 && strcmp(argv[2], "quick")==0;
+
+    vector<int> arms      = quick ? vector<int>{10} : vector<int>{10, 30, 100, 300};
+    vector<int> stars     = quick ? vector<int>{2}  : vector<int>{2, 5, 10, 20};
+    vector<pair<int, int>> dendrimers = quick ? vector<pair<int, int>>{{3,2}} : vector<pair<int, int>>{{3,2}, {3,4}, {4,3}, {3,6}};
+
+    // Derivation
+    for (int N : arms)
+      Isolated([&]{ Derive("derive/star",     "\"N\": "+to_string(N), "star",    [&](World& w){ Star(w, N); }); });
+    for (int N : arms)
+      Isolated([&]{ Derive("derive/micelle",  "\"N\": "+to_string(N), "micelle", [&](World& w){ Micelle(w, N); }); });
+    for (auto& fg : dendrimers)
+      Isolated([&]{ Derive("derive/dendrimer", "\"f\": "+to_string(fg.first)+", \"g\": "+to_string(fg.second), "dendrimer",
+                           [&](World& w){ vector<string> tips; Dendrimer(w, fg.first, fg.second, tips); }); });
+    for (int N : stars)
+      Isolated([&]{ Derive("derive/starchain", "\"N\": "+to_string(N), "chain",  [&](World& w){ StarChain(w, N); }); });
+
+    // Trace of deriving the largest star chain, open trace.json in Perfetto to see where the time goes.
+    Isolated([&]{
+      World w("bench");
+      StarChain(w, stars.back());
+      w.setTracing();
+      w.FormFactor("chain");
+      w.WriteTrace("trace.json");
+    });
+
+    // Path searches between the tips of the largest dendrimer.
+    Isolated([&]{
+      auto fg = dendrimers.back();
+      World w("bench");
+      vector<string> tips;
+      Dendrimer(w, fg.first, fg.second, tips);
+
+      int n = min<int>(tips.size(), 50), paths = 0;
+      long steps = 0;
+      auto t0 = chrono::steady_clock::now();
+      for (int i=0; i<n; i++)
+         for (int j=i+1; j<n; j++, paths++)
+             steps += w.findpath(tips[i], tips[j]).size();
+
+      ostringstream os;
+      os << "\"paths\": " << paths << ", \"steps\": " << steps << ", \"pathspersecond\": " << paths/Seconds(t0);
+      Report("findpath", "\"f\": "+to_string(fg.first)+", \"g\": "+to_string(fg.second), os.str());
+    });
+
+    // Evaluation of the form factor of each sub-unit type.
+    vector<pair<string, vector<string>>> types = {
+        {"GaussianPolymer", {"Rg"}}, {"GaussianLoop", {"Rg"}}, {"ThinRod", {"L"}}, {"ThinCircle", {"R"}},
+        {"ThinDisk", {"R"}}, {"ThinSphericalShell", {"R"}}, {"SolidSphere", {"R"}},
+        {"SolidSphericalShell", {"Ri", "Ro"}}, {"SolidCylinder", {"R", "L"}} };
+
+    for (auto& t : types)
+      Isolated([&]{
+         World w("bench");
+         w.Add(t.first, "s");
+
+         ParameterList pl;
+         double value = 1;
+         for (auto& p : t.second) w.setParameter(pl, p+"_s", value++);     // Ri < Ro
+         w.setParameter(pl, "beta_s", 1);
+
+         DoubleVector q = w.logspace(0.01, 10, quick ? 100 : 1000);
+         ex F = w.FormFactor("s");
+
+         int repeats = 0;
+         auto t0 = chrono::steady_clock::now();
+         do { w.Evaluate(F, pl, q); repeats++; } while (Seconds(t0) < (quick ? 0.1 : 1));
+         double seconds = Seconds(t0);
+
+         // The same compiled by Evaluator, which World::Complexity estimates the cost of.
+         Evaluator ev(F);
+         EvaluatorWorkspace ws;
+         ev.Prepare(ws, q.size());
+         ev.setVariables(ws, pl);
+         ev.setVariable(ws, w.GetSymbolInterface()->getSymbol("q"), q);
+
+         int crepeats = 0;
+         t0 = chrono::steady_clock::now();
+         do { ev.Compute(ws); crepeats++; } while (Seconds(t0) < (quick ? 0.1 : 1));
+         double cseconds = Seconds(t0);
+
+         ostringstream os;
+         os << "\"points\": " << q.size()*repeats << ", \"perpoint\": " << seconds/(q.size()*repeats)
+            << ", \"compiledperpoint\": " << cseconds/(q.size()*crepeats) << ", \"estimated\": " << w.Complexity(F).seconds;
+         Report("evaluate/"+t.first, "\"q\": "+to_string(q.size()), os.str());
+      });
+
+    ofstream fo(output);
+    fo << "{\n  \"threads\": " << NumberOfThreads() << ",\n  \"results\": [\n";
+    for (size_t i=0; i<results.size(); i++)
+        fo << results[i] << (i+1<results.size() ? ",\n" : "\n");
+    fo << "  ]\n}\n";
+}
+
+catch (const SEBException e)
+{
+    std::cout << e;                    // Print what the error was, and where it was triggered.
+    return 1;
+}
+
+}
@@ -0,0 +1,116 @@
+// Standard C++ headers
+#include<iostream>
+#include<thread>
+#include<sstream>
+
+// Include SEB functionality
+#include "SEB.hpp"
+
+/*
+
+    In this example we build and evaluate many worlds concurrently, one on each thread, for instance
+    when fitting several samples at the same time.
+
+    Each world is created with a private symbol table, such that worlds do not share any symbols.
+    GiNaC itself is not thread safe, hence every thread holds a GiNaCLock while it builds structures,
+    derives expressions and binds parameters. The numerical evaluation with a compiled Evaluator does
+    not involve GiNaC, so the lock is released while computing and the threads run in parallel.
+
+    Finally the concurrent results are compared to evaluating the same structures one by one. The program
+    exits with a non-zero status if any world failed or the results deviate more than a relative tolerance.
+
+*/
+
+// Builds the star with f arms in its own world.
+World::Derivation BuildStar(World& w, int f)
+{
+    GraphID g = w.Add(new Point(), "center");
+    for (int i=0; i<f; i++)
+       w.Link(new GaussianPolymer(), "arm"+to_string(i)+".end1", "center.point", "arm");
+    w.Add(g, "star");
+
+    World::Derivation d = w.Derive( [&]{ return w.FormFactor("star"); } );
+    w.setParameter(d.parameters, "beta_arm", 1.0);
+    w.setParameter(d.parameters, "Rg_arm", 10.0+f);
+    return d;
+}
+
+int main()
+{
+ try{
+    const int nWorlds = 2*NumberOfThreads();
+    DoubleVector qvec = World().logspace(0.001, 1.0, 500);
+
+    vector<DoubleVector> concurrent(nWorlds);
+    vector<thread> threads;
+    vector<string> errors(nWorlds);
+
+    for (int k=0; k<nWorlds; k++)
+       threads.push_back( thread( [&, k]
+         {
+          try{
+            GiNaCLock lock;                            // Held whenever this thread works with GiNaC expressions.
+
+            World w("World"+to_string(k), true);       // Private symbol table.
+            World::Derivation d = BuildStar(w, 2+k);
+
+            Evaluator ev(d.expression);
+            EvaluatorWorkspace ws;
+            ev.Prepare(ws, qvec.size());
+            ev.setVariables(ws, d.parameters);
+            ev.setVariable(ws, w.GetSymbolInterface()->getSymbol("q"), qvec);
+
+            lock.unlock();
+            ev.Compute(ws);                            // Pure numerics, runs in parallel with the other threads.
+            const double* F = ev.Output(ws, 0);
+            concurrent[k].assign(F, F+qvec.size());
+            lock.lock();                               // The world and evaluator are destroyed under the lock.
+           }
+          catch (const SEBException e)
+           {
+            ostringstream os;
+            os << e;
+            errors[k] = os.str();
+           }
+          catch (const std::exception& e)
+           {
+            errors[k] = string(e.what())+"\n";
+           }
+         } ) );
+
+    for (auto& t : threads) t.join();
+
+    bool failed = false;
+    for (int k=0; k<nWorlds; k++)
+       if (!errors[k].empty()) { cout << "World " << k << " failed:\n" << errors[k]; failed = true; }
+
+    // Compare with evaluating the worlds one at a time.
+    const double tolerance = 1e-10;
+    double maxdiff = 0;
+    for (int k=0; k<nWorlds; k++)
+      {
+        World w("World"+to_string(k));
+        World::Derivation d = BuildStar(w, 2+k);
+        DoubleVector serial = w.Evaluate(d.expression, d.parameters, qvec);
+
+        if (errors[k].empty() && concurrent[k].size() != qvec.size())
+          { cout << "World " << k << " returned " << concurrent[k].size() << " values, expected " << qvec.size() << "\n"; failed = true; }
+
+        for (size_t i=0; i<qvec.size() && i<concurrent[k].size(); i++)
+           maxdiff = max(maxdiff, fabs(serial[i]-concurrent[k][i])/max(fabs(serial[i]), 1e-300));
+      }
+
+    cout << "Evaluated " << nWorlds << " worlds concurrently, largest relative deviation from serial evaluation: " << maxdiff << "\n";
+
+    if (maxdiff > tolerance)
+      { cout << "Deviation exceeds the tolerance " << tolerance << "\n"; failed = true; }
+
+    return failed ? 1 : 0;
+ }
+catch (const SEBException e)
+{
+    std::cout << e;                    // Print what the error was, and where it was triggered.
+    return 1;
+}
+
+}
@@ -0,0 +1,71 @@
+// Standard C++ headers
+#include<iostream>
+
+// Include SEB functionality
+#include "SEB.hpp"
+
+/*
+
+    In this example we calculate the scattering from a concentration series of micelles using the decoupling approximation
+
+          I(q) = F(q) + A(q)^2 (S(q)-1)
+
+    where A is the form factor amplitude of a micelle relative to the centre of its core, and S(q) is the
+    Percus-Yevick hard-sphere structure factor. F and A are only evaluated once, and reused for all concentrations.
+
+*/
+
+int main()
+{
+ try{
+    World w("World");
+
+    // Spherical core with N polymers attached at random points on its surface.
+    GraphID g = w.Add(new SolidSphere(), "core");
+
+    int N=20;
+    for (int i=0; i<N; i++)
+       w.Link(new GaussianPolymer(), "poly"+to_string(i)+".end1", "core.surface#r"+to_string(i), "poly");
+
+    w.Add(g, "micelle");
+
+    ex F = w.FormFactor("micelle");
+    ex A = w.FormFactorAmplitude("micelle:core.center");
+
+    ParameterList params;
+    w.setParameter(params, "beta_core", 10);
+    w.setParameter(params, "beta_poly", 1);
+    w.setParameter(params, "R_core",   50);
+    w.setParameter(params, "Rg_poly",  20);
+
+    DoubleVector qvec = w.logspace(0.001, 0.5, 200);
+
+    // Evaluate F and A^2 once.
+    SymbolInterface *GLEX = SymbolInterface::instance();
+    DecouplingModel model(F, A, GLEX->getSymbol("q"));
+    model.Compute(params, qvec);
+
+    // Intensities of a concentration series, hard-sphere radius includes the polymer corona.
+    vector<double> phis = {0.05, 0.1, 0.2, 0.3};
+    vector<DoubleVector> I;
+    for (auto phi : phis)
+        I.push_back( model.Intensity( HardSpherePY(90, phi) ) );
+
+    // The same for a single concentration, with sticky spheres.
+    StickyHardSphere sticky(90, 0.1, 0.2);
+    DoubleVector Isticky = w.EvaluateDecoupling(F, A, params, qvec, sticky);
+
+    cout << "# q  F  I(phi=0.05)  I(phi=0.1)  I(phi=0.2)  I(phi=0.3)  I(sticky)\n";
+    for (int i=0; i<qvec.size(); i++)
+      {
+        cout << qvec[i] << " " << model.getFormFactor()[i];
+        for (auto& Ip : I) cout << " " << Ip[i];
+        cout << " " << Isticky[i] << "\n";
+      }
+ }
+catch (const SEBException e)
+{
+    std::cout << e;                    // Print what the error was, and where it was triggered.
+}
+
+}
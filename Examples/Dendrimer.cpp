@@ -48,7 +48,7 @@ void AddBranches(int g, int f, string name, World& w)
 int main()
 {
  try{
-    World w = World("w");
+    World w("w");
 
     int f = 4;  // 4 functional links
     int g= 3;   // 3 generations         
@@ -71,6 +71,9 @@ int main()
     // Name the first generation
     w.Add(dendrimer, "dendrimer");
 
+    // Search for paths between the many pairs of polymers on all cores. The expressions are unchanged.
+    w.setParallelDerivation();
+
     cout << "Form Factor of dendrimer:" << endl;
     cout <<  w.FormFactor("dendrimer") << endl;
 
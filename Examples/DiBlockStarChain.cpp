@@ -64,7 +64,7 @@
 int main()
 {
  try{
-    World w = World("w");
+    World w("w");
 
     // Define diblock copolymer
     GraphID diblock = w.Add(new GaussianPolymer(), "polyA");
@@ -88,14 +88,36 @@ int main()
 
     // Define latex as ouput format
     cout << latex;
+    // Reference points that are used repeatedly can be parsed and validated once.
+    RefHandle end1 = w.ref("chain:star1:diblock1:polyB.end2");
+    RefHandle end3 = w.ref("chain:star1:diblock3:polyB.end2");
+    RefHandle chainHandle = w.ref("chain");
+
     cout << "Phasefactor: -----------------------------------------------------\n";
-    cout <<  w.PhaseFactor("chain:star1:diblock1:polyB.end2","chain:star1:diblock3:polyB.end2") << endl;
+    cout <<  w.PhaseFactor(end1, end3) << endl;
 
     cout << "Formfactor Amplitude: -----------------------------------------------------\n";
-    cout <<  w.FormFactorAmplitude("chain:star1:diblock1:polyB.end2") << endl;
+    cout <<  w.FormFactorAmplitude(end1) << endl;
 
     cout << "Formfactor : -----------------------------------------------------\n";
-    cout <<  w.FormFactor("chain") << endl;
+    ex F = w.FormFactor(chainHandle);
+    cout <<  F << endl;
+
+    // Evaluate the form factor one level of structures at a time, where the F, A and Psi of stars and diblocks
+    // are evaluated numerically once, rather than expanding all terms. The two evaluations should agree.
+    ParameterList params;
+    w.setParameter(params, "beta_polyA", 1);
+    w.setParameter(params, "beta_polyB", 2);
+    w.setParameter(params, "Rg_polyA", 10);
+    w.setParameter(params, "Rg_polyB", 5);
+
+    DoubleVector qvec = w.logspace(0.001, 1.0, 50);
+    DoubleVector I1 = w.Evaluate(F, params, qvec);
+    DoubleVector I2 = w.EvaluateByLevels("chain", params, qvec);
+
+    cout << dflt;
+    for (size_t i=0; i<qvec.size(); i++)
+       cout << qvec[i] << " " << I1[i] << " " << I2[i] << "\n";
 
 }
 catch (const SEBException e)
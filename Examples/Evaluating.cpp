@@ -51,6 +51,26 @@ int main()
     // Use evaluate to evaluate the expresion and save the result to a file
     DoubleVector qvec2=w.logspace(0.01, 10.0, 1000 );
     w.Evaluate( F, params, qvec2, "formfactor_diblock.q", "Form factor of a diblock copolymer.");
+
+    // Use adaptive sampling, to get a compact set of q values that resolves the curve to a relative accuracy of 1e-3.
+    AdaptiveGrid grid = w.EvaluateAdaptive( F, params, 0.01, 10.0, 1e-3);
+    grid.Save("formfactor_diblock_adaptive.q", "Form factor of a diblock copolymer, adaptively sampled.");
+    cout << "Adaptive sampling used " << grid.size() << " points, interpolated value at q=0.1 " << grid.Interpolate(0.1) << "\n";
+
+    // In a fitting loop, compile the expression once and update only the terms depending on changed parameters.
+    Evaluator ev(F);
+    EvaluatorWorkspace ws;
+    ev.Prepare(ws, qvec.size());
+    ev.setVariables(ws, params);
+    ev.setVariable(ws, w.GetSymbolInterface()->getSymbol("q"), qvec);
+    ev.Compute(ws);
+
+    int RgB = ev.getIndex( w.GetSymbolInterface()->getSymbol("Rg_B") );
+    ev.setVariable(ws, RgB, 2.5);
+    ev.Update(ws);                                // Only the terms involving Rg_B are recomputed.
+
+    vector<DoubleVector> J = ev.Jacobian(ws, 0, { ev.getIndex( w.GetSymbolInterface()->getSymbol("Rg_A") ), RgB });
+    cout << "dF/dRg_A= " << J[0][0] << " dF/dRg_B= " << J[1][0] << " at q=" << qvec[0] << "\n";
    
 }
 
@@ -10,10 +10,47 @@
        
        This code outputs:
        Bad symbol in variable name:$%& at getSymbol(const string&)  
+
+       The world is left unchanged when Add or Link throws, and the sub-unit remains owned by the caller.
+       The second part checks this by linking a sub-unit with a tag to a non-existing reference point,
+       deleting it, and linking a valid sub-unit with the same tag, which must not share anything with
+       the deleted one. The program returns 1 if the form factors differ.
 */
 
+// Links a polymer with tag "poly" to a bad reference point, and then a valid one. Returns the form factor of the valid one.
+ex RecoverFromFailedLink(World& w)
+{
+    w.Add(new GaussianPolymer(), "polyA");
+
+    GaussianPolymer* bad = new GaussianPolymer();
+    try {
+        w.Link(bad, "polyB.end1", "polyA.noend", "poly");
+    }
+    catch (const SEBException& e) {
+        std::cout << "Link failed as expected: " << e.what() << endl;
+        delete bad;
+    }
+
+    w.Link(new GaussianPolymer(), "polyC.end1", "polyA.end2", "poly");
+    return w.FormFactor("polyC");
+}
+
 int main()
 {
+    World w1("recover");
+    ex F1 = RecoverFromFailedLink(w1);
+
+    World w2("reference");
+    w2.Add(new GaussianPolymer(), "polyA");
+    w2.Link(new GaussianPolymer(), "polyC.end1", "polyA.end2", "poly");
+    ex F2 = w2.FormFactor("polyC");
+
+    if (!(F1-F2).is_zero())
+      {
+        std::cout << "Form factor after a failed Link differs: " << F1 << "  vs.  " << F2 << endl;
+        return 1;
+      }
+    std::cout << "Form factor after a failed Link is correct" << endl;
 
 
 try
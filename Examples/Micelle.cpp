@@ -37,7 +37,7 @@ int main()
              string name = string("poly")+to_string(i)+string(".end1");
              string ref  = string("sphere.surface#r")+to_string(i);
              
-             w.Link(new GaussianPolymer(), name, ref, "poly");
+             w.Link<GaussianPolymer>(name, ref, "poly");       // Same as w.Link(new GaussianPolymer(), ..), but allocated in the pool of w.
           }
 
     // Define micelle structure
@@ -46,12 +46,29 @@ int main()
     // Define latex as ouput format
     cout << latex;
     cout <<  "Form factor= ";
-    cout <<  w.FormFactor("micelle") << endl << endl;
+    ex F = w.FormFactor("micelle");
+    cout <<  F << endl << endl;
 
     cout <<  "Form factor amplitude relative to centre= ";
-    cout <<  w.FormFactorAmplitude("micelle:sphere.center") << endl << endl;
+    ex A = w.FormFactorAmplitude("micelle:sphere.center");
+    cout <<  A << endl << endl;
 
     cout <<  "Phase factor tip-to-tip= ";
-    cout <<  w.PhaseFactor("micelle:poly0.end2","micelle:poly1.end2") << endl << endl;
+    ex P = w.PhaseFactor("micelle:poly0.end2","micelle:poly1.end2");
+    cout <<  P << endl << endl;
+
+    // Evaluate all three together, the sphere and polymer terms they share are only computed once for each q.
+    ParameterList params;
+    w.setParameter(params, "R_sphere", 50);
+    w.setParameter(params, "beta_sphere", 1);
+    w.setParameter(params, "Rg_poly", 20);
+    w.setParameter(params, "beta_poly", 1);
+
+    DoubleVector qvec = w.logspace(0.001, 1.0, 100);
+    vector<DoubleVector> I = w.Evaluate( {F, A, P}, params, qvec );
+
+    cout << dflt;
+    for (size_t i=0; i<qvec.size(); i++)
+       cout << qvec[i] << " " << I[0][i] << " " << I[1][i] << " " << I[2][i] << "\n";
 
 }
@@ -0,0 +1,62 @@
+// Standard C++ headers
+#include<iostream>
+#include<cmath>
+
+// Include SEB functionality
+#include "SEB.hpp"
+
+/*
+
+    In this example we calculate the scattering from a solution of micelles with a distribution of aggregation numbers.
+
+    Micelles with aggregation numbers N=10..30 are generated by a callback, all in the same world, but tagged
+    identically so they share the parameters R_core, Rg_poly, beta_core, and beta_poly. The total intensity is
+    the number weighted sum of the unnormalized form factors.
+
+*/
+
+int main()
+{
+ try{
+    World w("World");
+
+    // Build a micelle with aggregation number N, and return its unnormalized form factor.
+    auto micelle = [&w](int k)
+      {
+        int N = 10+k;
+        string core = "core"+to_string(N);
+        GraphID g = w.Add(new SolidSphere(), core, "core");
+        for (int i=0; i<N; i++)
+           w.Link(new GaussianPolymer(), "poly"+to_string(N)+"x"+to_string(i)+".end1", core+".surface#r"+to_string(i), "poly");
+
+        w.Add(g, "micelle"+to_string(N));
+        return w.FormFactor_Unnormalized("micelle"+to_string(N));
+      };
+
+    // Gaussian distribution of aggregation numbers around 20.
+    DoubleVector weights;
+    for (int k=0; k<=20; k++)
+       weights.push_back( exp(-pow(k-10, 2)/(2*3.0*3.0)) );
+
+    Mixture mix;
+    mix.Add(weights, micelle);
+
+    ParameterList params;
+    w.setParameter(params, "beta_core", 10);
+    w.setParameter(params, "beta_poly", 1);
+    w.setParameter(params, "R_core",   50);
+    w.setParameter(params, "Rg_poly",  20);
+
+    DoubleVector qvec = w.logspace(0.001, 0.5, 200);
+    DoubleVector I = mix.Evaluate(params, qvec);
+
+    cout << "# q  I(q)\n";
+    for (int i=0; i<qvec.size(); i++)
+       cout << qvec[i] << " " << I[i] << "\n";
+ }
+catch (const SEBException e)
+{
+    std::cout << e;                    // Print what the error was, and where it was triggered.
+}
+
+}
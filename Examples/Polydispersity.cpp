@@ -0,0 +1,63 @@
+// Standard C++ headers
+#include<iostream>
+
+// Include SEB functionality
+#include "SEB.hpp"
+
+/*
+
+    In this example we build a micelle of a spherical core with N polymers attached to the surface,
+    and show how to average its scattering over polydisperse core radii and polymer sizes.
+
+    Polydisperse parameters are declared with a distribution (SCHULZ, LOGNORMAL, GAUSSIAN), a relative
+    width sigma/mean, and optionally the number of quadrature nodes. The mean values are taken from
+    the parameter list as usual.
+
+*/
+
+int main()
+{
+ try{
+    World w("World");
+
+    // Spherical core with N polymers attached at random points on its surface.
+    GraphID g = w.Add(new SolidSphere(), "core");
+
+    int N=20;
+    for (int i=0; i<N; i++)
+       w.Link(new GaussianPolymer(), "poly"+to_string(i)+".end1", "core.surface#r"+to_string(i), "poly");
+
+    w.Add(g, "micelle");
+
+    ex F = w.FormFactor("micelle");
+    ex A = w.FormFactorAmplitude("micelle:core.center");
+
+    ParameterList params;
+    w.setParameter(params, "beta_core", 10);
+    w.setParameter(params, "beta_poly", 1);
+    w.setParameter(params, "R_core",   50);
+    w.setParameter(params, "Rg_poly",  20);
+
+    // Core radii are Schulz distributed with 10% relative width, polymer sizes are log-normal distributed with 20% relative width.
+    Polydispersity pd;
+    w.setPolydispersity(pd, "R_core",  SCHULZ,    0.1);
+    w.setPolydispersity(pd, "Rg_poly", LOGNORMAL, 0.2, 10);
+
+    DoubleVector qvec = w.logspace(0.001, 1.0, 200);
+    DoubleVector Fmono = w.Evaluate(F, params, qvec);
+    DoubleVector Fpoly = w.Evaluate(F, params, qvec, pd);
+
+    // Averages needed for the decoupling approximation  I(q) = <F> + <A>^2 (S(q)-1)
+    DoubleVector Favg, A2avg;
+    w.EvaluateDecoupling(F, A, params, qvec, pd, Favg, A2avg);
+
+    cout << "# q  F(monodisperse)  <F>  <A>^2\n";
+    for (int i=0; i<qvec.size(); i++)
+       cout << qvec[i] << " " << Fmono[i] << " " << Fpoly[i] << " " << A2avg[i] << "\n";
+ }
+catch (const SEBException e)
+{
+    std::cout << e;                    // Print what the error was, and where it was triggered.
+}
+
+}
@@ -0,0 +1,91 @@
+// Standard C++ headers
+#include<iostream>
+#include<chrono>
+
+// Include SEB functionality
+#include "SEB.hpp"
+
+/*
+
+    Checks the scattering expressions of a composite structure against Monte Carlo simulations of explicit conformations.
+
+    The example builds the micelle from Micelle.cpp, with N polymers attached at random points on the surface of a
+    spherical core, and compares the form factor, the form factor amplitude relative to the center and the phase factor
+    between two polymer ends with the averages over simulated conformations.
+
+    Finally the cost of evaluating the analytic form factor is compared to simulating it for a star of 1000 rods.
+
+*/
+
+double Seconds(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+}
+
+int main()
+{
+try{
+    World w("world");
+
+    // Spherical core
+    GraphID g = w.Add(new SolidSphere(), "sphere");
+
+    int N=20;
+    for (int i=0; i<N; i++)
+         w.Link<GaussianPolymer>("poly"+to_string(i)+".end1", "sphere.surface#r"+to_string(i), "poly");
+
+    w.Add(g, "micelle");
+
+    ex F = w.FormFactor("micelle");
+    ex A = w.FormFactorAmplitude("micelle:sphere.center");
+    ex P = w.PhaseFactor("micelle:poly0.end2","micelle:poly1.end2");
+
+    ParameterList params;
+    w.setParameter(params, "R_sphere", 50);
+    w.setParameter(params, "beta_sphere", 10);
+    w.setParameter(params, "Rg_poly", 20);
+    w.setParameter(params, "beta_poly", 1);
+
+    DoubleVector qvec = w.logspace(0.001, 0.5, 40);
+    vector<DoubleVector> I = w.Evaluate( {F, A, P}, params, qvec );
+
+    // The same from 20000 simulated conformations.
+    Simulator sim(w, "micelle", params);
+    DoubleVector Fs = sim.FormFactor(qvec, 20000);
+    DoubleVector As = sim.FormFactorAmplitude("micelle:sphere.center", qvec, 20000);
+    DoubleVector Ps = sim.PhaseFactor("micelle:poly0.end2","micelle:poly1.end2", qvec, 20000);
+
+    cout << "# q   F   F(simulated)   A   A(simulated)   Psi   Psi(simulated)\n";
+    for (size_t i=0; i<qvec.size(); i++)
+       cout << qvec[i] << " " << I[0][i] << " " << Fs[i] << " " << I[1][i] << " " << As[i] << " " << I[2][i] << " " << Ps[i] << "\n";
+
+
+    // Benchmark a star of 1000 rods.
+    World w2("star");
+    GraphID g2 = w2.Add(new Point(), "p");
+    for (int i=0; i<1000; i++)
+         w2.Link<ThinRod>("rod"+to_string(i)+".end1", "p.point", "rod");
+    w2.Add(g2, "star");
+
+    ParameterList params2;
+    w2.setParameter(params2, "L_rod", 10);
+    w2.setParameter(params2, "beta_rod", 1);
+
+    auto t0 = chrono::steady_clock::now();
+    DoubleVector Fstar = w2.Evaluate(w2.FormFactor("star"), params2, qvec);
+    cout << "\n# Star of 1000 rods, analytic form factor in " << Seconds(t0) << " s\n";
+
+    t0 = chrono::steady_clock::now();
+    Simulator sim2(w2, "star", params2);
+    DoubleVector Fstars = sim2.FormFactor(qvec, 1000);
+    cout << "# simulated form factor from 1000 conformations in " << Seconds(t0) << " s\n";
+
+    for (size_t i=0; i<qvec.size(); i++)
+       cout << qvec[i] << " " << Fstar[i] << " " << Fstars[i] << "\n";
+}
+catch (const SEBException& e)
+{
+    std::cout << e;                    // Print what the error was, and where it was triggered.
+}
+
+}
@@ -0,0 +1,57 @@
+// Standard C++ headers
+#include<iostream>
+
+// Include SEB functionality
+#include "SEB.hpp"
+
+/*
+
+    In this example we show how to smear the form factor of a solid sphere by the instrumental resolution,
+    such that it can be compared directly to measured SANS or SAXS data.
+
+    Pinhole smearing uses a Gaussian resolution function with a width given for each q point (or relative to q),
+    while slit smearing integrates along a slit of given length.
+
+*/
+
+int main()
+{
+ try{
+    World w("World");
+
+    w.Add(new SolidSphere(), "sphere");
+    ex F = w.FormFactor("sphere");
+
+    ParameterList params;
+    w.setParameter(params, "beta_sphere", 1);
+    w.setParameter(params, "R_sphere",   50);
+
+    DoubleVector qvec = w.linspace(0.001, 0.3, 300);
+
+    // Gaussian pinhole resolution with width dq=0.05 q, typical of SANS.
+    Resolution pinhole;
+    pinhole.setPinhole(0.05);
+
+    // Slit smearing, typical of Kratky cameras.
+    Resolution slit;
+    slit.setSlit(0.02);
+
+    DoubleVector F0 = w.Evaluate(F, params, qvec);
+    DoubleVector F1 = w.Evaluate(F, params, qvec, pinhole);
+    DoubleVector F2 = w.Evaluate(F, params, qvec, slit);
+
+    // Resolution can be combined with polydispersity.
+    Polydispersity pd;
+    w.setPolydispersity(pd, "R_sphere", SCHULZ, 0.05);
+    DoubleVector F3 = w.Evaluate(F, params, qvec, pd, pinhole);
+
+    cout << "# q  F  F(pinhole)  F(slit)  <F>(pinhole)\n";
+    for (int i=0; i<qvec.size(); i++)
+       cout << qvec[i] << " " << F0[i] << " " << F1[i] << " " << F2[i] << " " << F3[i] << "\n";
+ }
+catch (const SEBException e)
+{
+    std::cout << e;                    // Print what the error was, and where it was triggered.
+}
+
+}
@@ -0,0 +1,272 @@
+// Standard C++ headers
+#include<iostream>
+#include<fstream>
+#include<sstream>
+#include<chrono>
+#include<algorithm>
+#include<dirent.h>
+
+// Include SEB functionality
+#include "SEB.hpp"
+
+/*
+
+    Validates the scattering terms of all sub-unit types against the reference data in Validation/ in one run.
+
+    Each folder in Validation/ has a manifest naming the sub-unit type, its parameters, and the data file for each term:
+
+        subunit   SolidCylinder
+        parameter R 1
+        parameter L 1.5
+        F                 F.dat
+        A center          FFA_center.dat
+        P center ends     PF_center2ends.dat
+
+    As with ValidateXXFile, the maximal deviation from the data and from the Guinier expansion 1 - q^2 sigma<R^2>/6
+    (Rg^2/3 for form factors) are found. Terms are compiled to numerical programs, and evaluated on all cores. Terms that
+    can not be compiled are evaluated by GiNaC. Scattering terms of all sub-unit types without reference data are listed
+    as untested.
+
+    The results are written as JSON to Validation/report.json (or the file given as argument) with the deviations,
+    compile and evaluation times of every term, such that accuracy and performance can be tracked together.
+    The program exits with 1 if any term fails. Run it in the Examples folder, e.g. by make validate.
+
+*/
+
+struct Term
+{
+    string type, data, file;        // Sub-unit type, folder and data file
+    char kind;                      // F, A or P
+    string r1, r2;
+
+    ex expr;
+    double smsd;                    // Coefficient of q^2 in the Guinier expansion.
+    DoubleVector q, Iref, I;
+
+    Evaluator ev;
+    EvaluatorWorkspace ws;
+    bool numeric = true;            // Compiled, or evaluated by GiNaC
+
+    double compile = 0, evaluate = 0;
+    double dev = 0, devg = 0;
+    int countg = 0;
+
+    string name() const
+      {
+        if (kind=='F') return "F";
+        if (kind=='A') return "A["+r1+"]";
+        return "P["+r1+"]["+r2+"]";
+      }
+};
+
+double Seconds(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+}
+
+// Folders in dir with a manifest
+vector<string> Manifests(string dir)
+{
+    vector<string> ret;
+    DIR* d = opendir(dir.c_str());
+    if (!d) throw SEBException("Can not open folder "+dir+", run this from the Examples folder");
+
+    for (dirent* e = readdir(d); e; e = readdir(d))
+        if (ifstream(dir+"/"+e->d_name+"/manifest").good()) ret.push_back(e->d_name);
+    closedir(d);
+
+    sort(ret.begin(), ret.end());
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+ try{
+    string report = argc>1 ? argv[1] : "Validation/report.json";
+    double tolerance = 1e-4;
+
+    World w("World");
+    ex q = w.GetSymbolInterface()->getSymbol("q");
+
+    vector<Term> terms;
+    set<string> covered;           // e.g. "SolidCylinder A[center]"
+
+    // Read manifests, derive and compile their terms.
+    int count = 0;
+    for (auto& data : Manifests("Validation"))
+      {
+         ifstream manifest("Validation/"+data+"/manifest");
+         string name = "v"+to_string(count++), type, line;
+         SubUnit* s = nullptr;
+         ParameterList pl;
+
+         while (getline(manifest, line))
+           {
+              istringstream ls(line);
+              string key;
+              if (!(ls >> key) || key[0]=='#') continue;
+
+              if (key=="subunit")
+                {
+                   ls >> type;
+                   w.Add(type, name);
+                   s = w.getSubunit(name);
+                   continue;
+                }
+
+              if (!s) throw SEBException("Manifest of "+data+" must start with the sub-unit type");
+
+              if (key=="parameter")
+                {
+                   string p;
+                   double value;
+                   ls >> p >> value;
+                   w.setParameter(pl, p+"_"+name, value);
+                   continue;
+                }
+
+              Term t;
+              t.type = type;
+              t.data = data;
+              t.kind = key[0];
+              if (t.kind=='A') ls >> t.r1;
+              if (t.kind=='P') ls >> t.r1 >> t.r2;
+              if (t.kind=='P' && t.r2<t.r1) swap(t.r1, t.r2);      // Names as in the list of untested terms.
+              ls >> t.file;
+
+              ifstream fi("Validation/"+data+"/"+t.file);
+              if (!fi.is_open()) throw SEBException("Can not open input file Validation/"+data+"/"+t.file);
+              double qval, Ival;
+              while (fi >> qval >> Ival)
+                {
+                   t.q.push_back(qval);
+                   t.Iref.push_back(Ival);
+                }
+
+              auto t0 = chrono::steady_clock::now();
+              ex smsd;
+              t.expr = s->getValidationTerm(t.kind, t.r1, t.r2, pl, smsd);
+              smsd = smsd.evalf();
+              if (!is_a<numeric>(smsd)) throw SEBException("Expression for sigma<R^2> of "+t.name()+" for "+type+" did not evaluate to number");
+              t.smsd = ex_to<numeric>(smsd).to_double() / (t.kind=='F' ? 3 : 6);
+
+              try {
+                  t.ev = Evaluator(t.expr);
+                  t.ev.Prepare(t.ws, t.q.size());
+                  t.ev.setVariable(t.ws, q, t.q);
+              }
+              catch (SEBException&) {
+                  t.numeric = false;
+              }
+              t.compile = Seconds(t0);
+
+              covered.insert(type+" "+t.name());
+              terms.push_back(t);
+           }
+      }
+
+    // Evaluate compiled terms on all cores.
+    ParallelTasks(terms.size(), [&](int k)
+      {
+         Term& t = terms[k];
+         if (!t.numeric) return;
+
+         auto t0 = chrono::steady_clock::now();
+         t.ev.Compute(t.ws);
+         const double* I = t.ev.Output(t.ws, 0);
+         t.I.assign(I, I+t.q.size());
+         t.evaluate = Seconds(t0);
+      });
+
+    // and the remaining terms by GiNaC.
+    for (auto& t : terms)
+      {
+         if (t.numeric) continue;
+
+         auto t0 = chrono::steady_clock::now();
+         for (double qval : t.q)
+           {
+              ex Iex = t.expr.subs(q==qval).evalf();
+              if (!is_a<numeric>(Iex)) throw SEBException("Expression for "+t.name()+" of "+t.type+" did not evaluate to number");
+              t.I.push_back(ex_to<numeric>(Iex).to_double());
+           }
+         t.evaluate = Seconds(t0);
+      }
+
+    // Deviations from the data, and from the Guinier expansion where the 2nd order term is less than 0.01.
+    int failed = 0;
+    for (auto& t : terms)
+      {
+         for (size_t i=0; i<t.q.size(); i++)
+           {
+              t.dev = max(t.dev, fabs(t.I[i]-t.Iref[i]));
+              if (t.q[i]*t.q[i]*t.smsd < 0.01)
+                {
+                   t.devg = max(t.devg, fabs(1-t.q[i]*t.q[i]*t.smsd-t.Iref[i]));
+                   t.countg++;
+                }
+           }
+
+         bool ok = t.dev<tolerance && t.devg<tolerance;
+         if (!ok) failed++;
+         cout << (ok ? "OK      " : "WARNING ") << t.type << " " << t.name() << " against " << t.data << "/" << t.file
+              << "   max|dev|=" << t.dev << "  Guinier max|dev|=" << t.devg << "  " << 1e6*t.evaluate/t.q.size() << " us/point"
+              << (t.numeric ? "" : " (GiNaC)") << "\n";
+      }
+
+    // Terms of all sub-unit types without reference data
+    vector<string> untested;
+    for (string type : {"Point", "GaussianPolymer", "GaussianLoop", "ThinRod", "ThinCircle", "ThinDisk",
+                        "ThinSphericalShell", "SolidSphere", "SolidSphericalShell", "SolidCylinder"})
+      {
+         string name = "u"+type;
+         w.Add(type, name);
+         SubUnit* s = w.getSubunit(name);
+
+         ReferencePointSet refs(s->SpecificReferencepoints_cbegin(), s->SpecificReferencepoints_cend());
+         refs.insert(s->DistributedReferencepoints_cbegin(), s->DistributedReferencepoints_cend());
+
+         vector<string> names = {"F"};
+         for (auto& r1 : refs)
+           {
+              names.push_back("A["+r1+"]");
+              for (auto& r2 : refs)
+                 if (r1<r2 || (r1==r2 && s->hasDistributedReference(r1)))    // Phase factors between a specific reference point and itself are 1.
+                     names.push_back("P["+r1+"]["+r2+"]");
+           }
+
+         for (auto& n : names)
+             if (!covered.count(type+" "+n)) untested.push_back(type+" "+n);
+      }
+    cout << untested.size() << " terms without reference data, " << failed << " of " << terms.size() << " terms failed\n";
+
+    // Report
+    ofstream fo(report);
+    fo.precision(6);
+    fo << "{\n  \"tolerance\": " << tolerance << ",\n  \"failed\": " << failed << ",\n  \"terms\": [\n";
+    for (size_t k=0; k<terms.size(); k++)
+      {
+         Term& t = terms[k];
+         fo << "    { \"subunit\": \"" << t.type << "\", \"data\": \"" << t.data << "/" << t.file << "\", \"term\": \"" << t.name() << "\""
+            << ", \"points\": " << t.q.size() << ", \"maxdev\": " << t.dev
+            << ", \"guinierpoints\": " << t.countg << ", \"guiniermaxdev\": " << t.devg
+            << ", \"numeric\": " << (t.numeric ? "true" : "false")
+            << ", \"compile\": " << t.compile << ", \"evaluate\": " << t.evaluate
+            << ", \"ok\": " << (t.dev<tolerance && t.devg<tolerance ? "true" : "false") << " }"
+            << (k+1<terms.size() ? ",\n" : "\n");
+      }
+    fo << "  ],\n  \"untested\": [";
+    for (size_t k=0; k<untested.size(); k++)
+        fo << (k ? ", " : "") << "\"" << untested[k] << "\"";
+    fo << "]\n}\n";
+
+    return failed>0 ? 1 : 0;
+}
+
+catch (const SEBException e)
+{
+    std::cout << e;                    // Print what the error was, and where it was triggered.
+    return 1;
+}
+
+}
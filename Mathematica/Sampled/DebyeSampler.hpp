@@ -2,57 +2,237 @@
 #include <vector>
 #include <fstream>
 #include <string>
+#include <cmath>
+
+#include "MonteCarlo.hpp"
 
 using namespace std;
 
-class Sampler
+/*
+   Samples <sin(q r)/(q r)> and <r^2> for sampled distances r.
+
+   By default distances are binned in a fine histogram, and the Debye transform is done once when the
+   sampler is destroyed, so the cost of a sample does not depend on the number of q values. Within each
+   bin the mean and variance of the distances are kept, and the transform is corrected to second order
+   in the spread around the mean. The bin width defaults to 0.05/qmax, which leaves a relative error far
+   below the sampling noise. With binwidth=0 sin(q r)/(q r) is evaluated exactly for every sample.
+
+   Samples are added to the partial results of the calling thread, which MonteCarlo merges in a fixed order.
+
+   Besides the normalized result, the destructor writes the unnormalized sums to fn.state. States of independent
+   runs with different seeds can be added with Load, e.g. by MergeSamples, to combine runs done on many machines.
+   Nothing is written when the sampler is destroyed while an exception propagates, e.g. when Load fails.
+*/
+
+class Sampler : Accumulator
 {
-    long count=0;
-    double R2=0;
+    struct alignas(64) Partial
+    {
+        long count=0;
+        double R2=0;
+        valarray<double> I;       // Exact evaluation
+        vector<double> n;         // Samples in each bin
+        vector<double> s1, s2;    // Sum of distances and squared distances relative to the start of each bin.
+    };
+
     valarray<double> q;
-    valarray<double> I;
     string fnam="";
-    
+    double dr=0;              // Histogram bin width, 0 for exact evaluation.
+    int exceptions=uncaught_exceptions();     // Exceptions in flight when constructed, see ~Sampler.
+
+    vector<Partial> part;     // Partial results of each thread.
+    Partial total;
+
+    // sin(x)/x and its second derivative.
+    static double sinc(double x)
+      {
+         if (fabs(x)<1e-3) return 1-x*x/6;
+         return sin(x)/x;
+      }
+
+    static double sinc2(double x)
+      {
+         if (fabs(x)<1e-2) return -1.0/3+x*x/10;
+         return -sin(x)/x - 2*cos(x)/(x*x) + 2*sin(x)/(x*x*x);
+      }
+
+    static void add(vector<double>& a, vector<double>& b)
+      {
+         if (a.size()<b.size()) a.resize(b.size(), 0.0);
+         for (size_t i=0; i<b.size(); i++) a[i]+=b[i];
+         b.assign(b.size(), 0.0);
+      }
+
+    void transform()
+      {
+         for (size_t b=0; b<total.n.size(); b++)
+           {
+              if (total.n[b]==0) continue;
+              double m  = total.s1[b]/total.n[b];
+              double var= max(0.0, total.s2[b]/total.n[b]-m*m);
+              double r  = b*dr+m;
+
+              for (size_t i=0; i<q.size(); i++)
+                  total.I[i] += total.n[b]*( sinc(q[i]*r) + 0.5*var*q[i]*q[i]*sinc2(q[i]*r) );
+           }
+      }
+
+    void init()
+      {
+          total.I.resize(q.size(), 0.0);
+          for (auto& p : part) p.I.resize(q.size(), 0.0);
+      }
+
    public:
-    Sampler(vector<double> &qin, string fn)
+    Sampler(vector<double> &qin, string fn, double binwidth=-1) : part(MonteCarloThreads())
       {
           fnam=fn;
-          
+
           q.resize(qin.size());
-          I.resize(qin.size());
-          
+
+          double qmax=0;
           for (int i=0;i<qin.size();i++)
             {
                q[i]=qin[i];
-               I[i]=0.0;
+               qmax=max(qmax, qin[i]);
             }
+
+          dr = binwidth<0 && qmax>0 ? 0.05/qmax : max(binwidth, 0.0);
+          init();
+      }
+
+    // Sampler with the q values, bin width and sums of a state file.
+    Sampler(string fn, string state) : part(MonteCarloThreads())
+      {
+          fnam=fn;
+
+          ifstream is(state, ios::binary);
+          if (!is) throw runtime_error("Could not open "+state);
+
+          vector<double> qin;
+          ReadBinary(is, qin);
+          ReadBinary(is, dr);
+          q.resize(qin.size());
+          for (size_t i=0; i<qin.size(); i++) q[i]=qin[i];
+          init();
+
+          is.seekg(0);
+          Read(is);
       }
 
     ~Sampler()
       {
-          // Normalize          
-          R2/=count; I/=count;
-          
+          // Never overwrite earlier results with a partial run or merge, when destroyed by an exception.
+          if (uncaught_exceptions() > exceptions) return;
+
+          Merge(0);
+
+          ofstream state(fnam+".state", ios::binary);
+          Write(state);
+          state.close();
+
+          if (dr>0) transform();
+
+          // Normalize
+          total.R2/=total.count; total.I/=total.count;
+
           ofstream fo(fnam.c_str());
-          fo << "# <R^2> = " << R2 << endl; 
-       
+          fo << "# <R^2> = " << total.R2 << endl;
+
           for (int i=0;i<q.size();i++)
-               fo << q[i] << " " << I[i] << endl;
+               fo << q[i] << " " << total.I[i] << endl;
+
+          fo.close();
+      }
+
+     void Merge(int slot)
+      {
+         Partial& p = part[slot];
+
+         total.count+=p.count;
+         total.R2+=p.R2;
+         total.I+=p.I;
+         add(total.n, p.n);
+         add(total.s1, p.s1);
+         add(total.s2, p.s2);
 
-          fo.close();            
+         p.count=0;
+         p.R2=0;
+         p.I=0.0;
       }
-      
-     
+
+     void Write(ostream& os)
+      {
+         WriteBinary(os, vector<double>(begin(q), end(q)));
+         WriteBinary(os, dr);
+         WriteBinary(os, total.count);
+         WriteBinary(os, total.R2);
+         WriteBinary(os, vector<double>(begin(total.I), end(total.I)));
+         WriteBinary(os, total.n);
+         WriteBinary(os, total.s1);
+         WriteBinary(os, total.s2);
+      }
+
+     void Read(istream& is)
+      {
+         vector<double> qin, I, n, s1, s2;
+         double bw, R2;
+         long count;
+
+         ReadBinary(is, qin);
+         ReadBinary(is, bw);
+         if (bw!=dr || qin.size()!=q.size() || !equal(qin.begin(), qin.end(), begin(q)))
+             throw runtime_error("Sampler state for "+fnam+" has different q values or bin width");
+
+         ReadBinary(is, count);
+         ReadBinary(is, R2);
+         ReadBinary(is, I);
+         ReadBinary(is, n);
+         ReadBinary(is, s1);
+         ReadBinary(is, s2);
+
+         total.count+=count;
+         total.R2+=R2;
+         for (size_t i=0; i<q.size(); i++) total.I[i]+=I[i];
+         add(total.n, n);
+         add(total.s1, s1);
+         add(total.s2, s2);
+      }
+
+     // Adds the sums of a state file.
+     void Load(string state)
+      {
+         ifstream is(state, ios::binary);
+         if (!is) throw runtime_error("Could not open "+state);
+         Read(is);
+      }
+
      void add(double dx,double dy,double dz)
       {
+         Partial& p = part[mcSlot];
+
          double r2=dx*dx+dy*dy+dz*dz;
          double r=sqrt(r2);
-         
-         R2+=r2;
-         I += sin(q*r)/(q*r);
-         
-         count++;
+
+         p.R2+=r2;
+         p.count++;
+
+         if (dr>0)
+           {
+              size_t b=r/dr;
+              if (b>=p.n.size())
+                {
+                   p.n.resize(b+1, 0.0);
+                   p.s1.resize(b+1, 0.0);
+                   p.s2.resize(b+1, 0.0);
+                }
+              double d=r-b*dr;
+              p.n[b]++;
+              p.s1[b]+=d;
+              p.s2[b]+=d*d;
+           }
+         else
+              for (size_t i=0; i<q.size(); i++) p.I[i] += sinc(q[i]*r);
       }
 
 };
-
@@ -1,79 +1,79 @@
 #include <numbers>
+#include <cmath>
+#include <random>
 
 /*
    Various generators for randomly distributed 3D vectors.
-   
+
    For 2D objects we set z to zero.
 
+   All generators sample directly by inverting the cumulative distributions, so every call draws a
+   fixed number of random numbers from the thread's engine re without rejection loops.
+
 */
 
+// Uniform random number in [0:1) from the upper 53 bits of the engine, about twice as fast as generate_canonical.
+inline double Uniform()
+{
+    return (re() >> 11)*0x1.0p-53;
+}
+
+// Random direction scaled by r
+inline void RandomDirection(double r, double &x, double &y, double &z)
+{
+    double c   = 2*Uniform()-1;                     // cos(theta) is uniform for points on a sphere.
+    double phi = 2*std::numbers::pi*Uniform();
+    double s   = sqrt(max(0.0, 1-c*c));
+
+    x= r*s*cos(phi);
+    y= r*s*sin(phi);
+    z= r*c;
+}
+
 // Random point in a spherical shell Ri to Ro
-void RandomSolidShell(double& Ri, double&Ro, double &x, double &y, double &z, auto& dist)
+void RandomSolidShell(double Ri, double Ro, double &x, double &y, double &z)
 {
-    double R;
-    do
-      {
-        x= Ro*dist(re);
-        y= Ro*dist(re);
-        z= Ro*dist(re);
-        
-        R=sqrt(x*x+y*y+z*z);
-      }
-    while (R>Ro || R<Ri);
+    double Ri3=Ri*Ri*Ri;
+    double r = cbrt( Ri3 + (Ro*Ro*Ro-Ri3)*Uniform() );     // Volume inside r grows as r^3
+    RandomDirection(r, x,y,z);
 }
 
 // Random point inside sphere
-void RandomSphere(double R, double &x, double &y, double &z, auto& dist)
+void RandomSphere(double R, double &x, double &y, double &z)
 {
-    double d2;
-    do
-      {
-        x= R*dist(re);
-        y= R*dist(re);
-        z= R*dist(re);
-        d2=x*x+y*y+z*z;
-      }
-    while (d2>R*R);
+    RandomDirection(R*cbrt(Uniform()), x,y,z);
 }
 
 // Random point on surface of sphere with R
-void RandomSurface(double R, double &x, double &y, double &z, auto& dist)
+void RandomSurface(double R, double &x, double &y, double &z)
 {
-    double d2;
-    do
-      {
-        x= R*dist(re);
-        y= R*dist(re);
-        z= R*dist(re);
-        d2=x*x+y*y+z*z;
-      }
-    while (d2>R*R || d2<1e-5);
-    
-    x*=R/sqrt(d2);
-    y*=R/sqrt(d2);
-    z*=R/sqrt(d2);
+    RandomDirection(R, x,y,z);
+}
+
+// Random point on the inner or outer surface of a spherical shell, weighted by their areas.
+void RandomShellSurface(double Ri, double Ro, double &x, double &y, double &z)
+{
+    double Pout = Ro*Ro/(Ri*Ri+Ro*Ro);
+    RandomSurface(Uniform()<Pout ? Ro : Ri, x,y,z);
 }
 
 // Random point on a circular disk (x,y) with radius R    z=0
-void RandomDisk(double R, double &x, double &y, double &z, auto& dist)
+void RandomDisk(double R, double &x, double &y, double &z)
 {
-    z= 0;
-    double d2;
-    do
-      {
-        x= R*dist(re);
-        y= R*dist(re);
-        d2=x*x+y*y;
-      }
-    while (d2>R*R || d2<1e-5);
+    double r   = R*sqrt(Uniform());                  // Area inside r grows as r^2
+    double phi = 2*std::numbers::pi*Uniform();
+
+    x=r*cos(phi);
+    y=r*sin(phi);
+    z=0;
 }
 
 
 
 // Random point on a circle with radius R
-void RandomCircle(double R, double &x, double &y, double &z, auto& dist)
+void RandomCircle(double R, double &x, double &y, double &z)
 {
-    double theta=std::numbers::pi*dist(re);
+    double theta=2*std::numbers::pi*Uniform();
 
     x=R*cos(theta);
     y=R*sin(theta);
@@ -82,26 +82,141 @@ void RandomCircle(double R, double &x, double &y, double &z, auto& dist)
 
 
 // Random point inside cyllinder.
-void RandomSolidCylinder(double L, double R, double &x, double &y, double &z, auto& dist)
+void RandomSolidCylinder(double L, double R, double &x, double &y, double &z)
+{
+    RandomDisk(R, x,y,z);
+    z= L*(Uniform()-0.5);
+}
+
+// Random point on the hull of a cylinder
+void RandomCylinderHull(double L, double R, double &x, double &y, double &z)
+{
+    RandomCircle(R, x,y,z);
+    z= L*(Uniform()-0.5);
+}
+
+// Random point on one of the two end caps of a cylinder
+void RandomCylinderEnd(double L, double R, double &x, double &y, double &z)
 {
-    double d2;
-    do
+    RandomDisk(R, x,y,z);
+    z= Uniform()<0.5 ? -L/2 : L/2;
+}
+
+// Random point on the surface of a cylinder, hull or ends weighted by their areas.
+void RandomCylinderSurface(double L, double R, double &x, double &y, double &z)
+{
+    double Phull = L/(L+R);                          // 2 pi R L / (2 pi R L + 2 pi R^2)
+    if (Uniform()<Phull) RandomCylinderHull(L, R, x,y,z);
+                   else  RandomCylinderEnd(L, R, x,y,z);
+}
+
+
+/*
+   Batch variants, generating all points of a Points at once. The random numbers are drawn into arrays first, and the
+   coordinates are then computed in plain loops over these arrays, which the compiler can vectorize. Use them with a
+   MonteCarlo body taking a range of iterations (begin, end).
+*/
+
+// Coordinates of n points in separate arrays.
+struct Points
+{
+    vector<double> x, y, z;
+
+    explicit Points(long n) : x(n), y(n), z(n) {}
+    long size() const { return x.size(); }
+};
+
+// n uniform random numbers in [0:1)
+inline vector<double> Uniform(long n)
+{
+    vector<double> u(n);
+    for (auto& v : u) v = re() >> 11;
+    for (auto& v : u) v *= 0x1.0p-53;
+    return u;
+}
+
+// Random directions scaled by r[i]
+inline void RandomDirection(const vector<double>& r, Points& p)
+{
+    vector<double> c = Uniform(p.size()), phi = Uniform(p.size());
+    for (long i=0; i<p.size(); i++)
       {
-        x= R*dist(re);
-        y= R*dist(re);
-        d2=x*x+y*y;
+        double ci = 2*c[i]-1;
+        double s  = sqrt(max(0.0, 1-ci*ci));
+
+        p.x[i]= r[i]*s*cos(2*std::numbers::pi*phi[i]);
+        p.y[i]= r[i]*s*sin(2*std::numbers::pi*phi[i]);
+        p.z[i]= r[i]*ci;
       }
-    while (d2>R*R);
-    z= L/2*dist(re);
 }
 
-// Random point on a circle with radius R
-void RandomCylinderHull(double L, double R, double &x, double &y, double &z, auto& dist)
+// Random points in a spherical shell Ri to Ro
+void RandomSolidShell(double Ri, double Ro, Points& p)
 {
-    double theta=std::numbers::pi*dist(re);
+    double Ri3=Ri*Ri*Ri;
+    vector<double> r = Uniform(p.size());
+    for (auto& v : r) v = cbrt( Ri3 + (Ro*Ro*Ro-Ri3)*v );
+    RandomDirection(r, p);
+}
 
-    x=R*cos(theta);
-    y=R*sin(theta);
-    z=L/2*dist(re);
+// Random points inside sphere
+void RandomSphere(double R, Points& p)
+{
+    vector<double> r = Uniform(p.size());
+    for (auto& v : r) v = R*cbrt(v);
+    RandomDirection(r, p);
 }
 
+// Random points on surface of sphere with R
+void RandomSurface(double R, Points& p)
+{
+    RandomDirection(vector<double>(p.size(), R), p);
+}
+
+// Random points on a circular disk (x,y) with radius R    z=0
+void RandomDisk(double R, Points& p)
+{
+    vector<double> r = Uniform(p.size()), phi = Uniform(p.size());
+    for (long i=0; i<p.size(); i++)
+      {
+        p.x[i]= R*sqrt(r[i])*cos(2*std::numbers::pi*phi[i]);
+        p.y[i]= R*sqrt(r[i])*sin(2*std::numbers::pi*phi[i]);
+        p.z[i]= 0;
+      }
+}
+
+// Random points on a circle with radius R
+void RandomCircle(double R, Points& p)
+{
+    vector<double> theta = Uniform(p.size());
+    for (long i=0; i<p.size(); i++)
+      {
+        p.x[i]= R*cos(2*std::numbers::pi*theta[i]);
+        p.y[i]= R*sin(2*std::numbers::pi*theta[i]);
+        p.z[i]= 0;
+      }
+}
+
+// Random points inside cylinder.
+void RandomSolidCylinder(double L, double R, Points& p)
+{
+    RandomDisk(R, p);
+    vector<double> u = Uniform(p.size());
+    for (long i=0; i<p.size(); i++) p.z[i]= L*(u[i]-0.5);
+}
+
+// Random points on the hull of a cylinder
+void RandomCylinderHull(double L, double R, Points& p)
+{
+    RandomCircle(R, p);
+    vector<double> u = Uniform(p.size());
+    for (long i=0; i<p.size(); i++) p.z[i]= L*(u[i]-0.5);
+}
+
+// Random points on the two end caps of a cylinder
+void RandomCylinderEnd(double L, double R, Points& p)
+{
+    RandomDisk(R, p);
+    vector<double> u = Uniform(p.size());
+    for (long i=0; i<p.size(); i++) p.z[i]= u[i]<0.5 ? -L/2 : L/2;
+}
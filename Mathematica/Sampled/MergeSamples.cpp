@@ -0,0 +1,34 @@
+/*
+
+    Combines sampler states of independent runs, e.g. runs with different seeds on a batch cluster.
+
+        MergeSamples FF.q run1/FF.q.state run2/FF.q.state ...
+
+    writes the normalized result of all runs to FF.q, and their summed state to FF.q.state.
+
+*/
+
+#include <iostream>
+#include "DebyeSampler.hpp"
+
+using namespace std;
+
+int main(int argc, char** argv)
+{
+   if (argc<3)
+     {
+        cerr << "Usage: " << argv[0] << " output.q input1.state [input2.state ...]\n";
+        return 1;
+     }
+
+   try
+     {
+        Sampler merged(argv[1], argv[2]);
+        for (int i=3; i<argc; i++) merged.Load(argv[i]);
+     }
+   catch (const exception& e)
+     {
+        cerr << e.what() << "\n";
+        return 1;
+     }
+}
@@ -0,0 +1,230 @@
+#ifndef MONTECARLO_HPP
+#define MONTECARLO_HPP
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace std;
+
+/*
+   Runs the iterations of a sampling loop on all cores, with results that are identical for a given seed
+   regardless of the number of threads.
+
+   The iterations are split in blocks of a fixed size. Each block seeds the random engine re of the thread
+   running it from (seed, block), and adds its samples to the partial results of that thread. When a block
+   is done, the partial results are merged into the totals in block order. Samplers and Sums register
+   themselves, so they are merged automatically.
+
+   With a checkpoint file the totals of all accumulators are written to it at intervals, and a run that was
+   interrupted resumes from the last checkpoint, with the same result as an uninterrupted run. The file is
+   removed when the run completes.
+
+   Usage:
+
+       MonteCarlo(N, seed, [&](long i)
+          {
+             RandomSphere(R, x,y,z);                           // Generators draw from the thread's engine re.
+             FF.add(x,y,z);
+          }, {.checkpoint = "FF.checkpoint"});
+
+   A body taking a range of iterations (begin, end) is called for batches of at most batchsize iterations instead,
+   e.g. to generate the points of a batch at once with the batch variants in GenerateSamples.hpp.
+*/
+
+// Random engine used by the generators in GenerateSamples.hpp, one per thread. Its period is so long that the streams
+// of different blocks never overlap, unlike the minstd default_random_engine with period 2^31.
+thread_local mt19937_64 re;
+
+// Partial results slot of this thread.
+thread_local int mcSlot = 0;
+
+inline int MonteCarloThreads()
+{
+    unsigned n = thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// Binary (de)serialization of accumulator states.
+template<class T> void WriteBinary(ostream& os, const T& x) { os.write((const char*) &x, sizeof(T)); }
+template<class T> void ReadBinary(istream& is, T& x)        { is.read((char*) &x, sizeof(T)); if (!is) throw runtime_error("Truncated sampler state"); }
+
+inline void WriteBinary(ostream& os, const vector<double>& v)
+{
+    WriteBinary(os, (long) v.size());
+    os.write((const char*) v.data(), v.size()*sizeof(double));
+}
+
+inline void ReadBinary(istream& is, vector<double>& v)
+{
+    long n;
+    ReadBinary(is, n);
+    v.resize(n);
+    is.read((char*) v.data(), n*sizeof(double));
+    if (!is) throw runtime_error("Truncated sampler state");
+}
+
+// Base of everything accumulating samples, i.e. holding partial results for each thread.
+class Accumulator
+{
+   public:
+    static vector<Accumulator*>& registry()
+      {
+         static vector<Accumulator*> r;
+         return r;
+      }
+
+    Accumulator()          { registry().push_back(this); }
+    virtual ~Accumulator() { auto& r=registry(); r.erase(remove(r.begin(), r.end(), this), r.end()); }
+
+    // Adds partial results of a slot to the totals and resets them.
+    virtual void Merge(int slot) = 0;
+
+    // Writes the totals, and adds totals written by Write to the totals.
+    virtual void Write(ostream& os) = 0;
+    virtual void Read(istream& is) = 0;
+
+    static void MergeAll(int slot) { for (auto a : registry()) a->Merge(slot); }
+};
+
+// Sum of sampled values.
+class Sum : Accumulator
+{
+    struct alignas(64) Partial { double sum=0; };
+    vector<Partial> part;
+    double total=0;
+
+   public:
+    Sum() : part(MonteCarloThreads()) {}
+
+    Sum& operator+=(double x) { part[mcSlot].sum+=x; return *this; }
+
+    void Merge(int slot) { total+=part[slot].sum; part[slot].sum=0; }
+
+    void Write(ostream& os) { WriteBinary(os, total); }
+    void Read(istream& is)  { double x; ReadBinary(is, x); total+=x; }
+
+    double value() { Merge(0); return total; }
+};
+
+struct MonteCarloOptions
+{
+    int threads = MonteCarloThreads();
+    long blocksize = 1<<20;
+    long batchsize = 1024;        // Iterations per call of a body taking a range (begin, end).
+    string checkpoint = "";       // No checkpoints if empty.
+    double interval = 600;        // Seconds between checkpoints.
+};
+
+/*
+   A checkpoint holds the run it belongs to, the number of merged blocks and the totals of all accumulators
+   in the order they were created. Returns the number of blocks already merged, or 0 if there is no checkpoint.
+*/
+inline long ReadCheckpoint(const string& fnam, long N, unsigned seed, long blocksize)
+{
+    ifstream is(fnam, ios::binary);
+    if (!is) return 0;
+
+    long n, b, merged, count;
+    unsigned s;
+    ReadBinary(is, n); ReadBinary(is, s); ReadBinary(is, b); ReadBinary(is, merged); ReadBinary(is, count);
+    if (n!=N || s!=seed || b!=blocksize || count!=(long) Accumulator::registry().size())
+        throw runtime_error("Checkpoint "+fnam+" belongs to a different run");
+
+    for (auto a : Accumulator::registry()) a->Read(is);
+    cout << "Resuming from " << fnam << " after " << merged << " blocks\n";
+    return merged;
+}
+
+inline void WriteCheckpoint(const string& fnam, long N, unsigned seed, long blocksize, long merged)
+{
+    {
+      ofstream os(fnam+".tmp", ios::binary);
+      WriteBinary(os, N); WriteBinary(os, seed); WriteBinary(os, blocksize); WriteBinary(os, merged);
+      WriteBinary(os, (long) Accumulator::registry().size());
+      for (auto a : Accumulator::registry()) a->Write(os);
+      if (!os) throw runtime_error("Could not write checkpoint "+fnam);
+    }
+    rename((fnam+".tmp").c_str(), fnam.c_str());      // Never leave a partially written checkpoint.
+}
+
+template<class Body>
+void MonteCarlo(long N, unsigned seed, Body body, MonteCarloOptions opt = {})
+{
+    const long blocksize = opt.blocksize;
+    const long blocks = (N+blocksize-1)/blocksize;
+    int threads = max(1, (int) min<long>(opt.threads, min<long>(blocks, MonteCarloThreads())));
+
+    long merged = opt.checkpoint.empty() ? 0 : ReadCheckpoint(opt.checkpoint, N, seed, blocksize);
+    atomic<long> next(merged);
+    auto lastCheckpoint = chrono::steady_clock::now();
+    bool failed = false;
+    mutex m;
+    condition_variable cv;
+    vector<exception_ptr> errors(threads);
+
+    auto worker = [&](int slot)
+      {
+         mcSlot = slot;
+         try
+           {
+             for (long b; (b=next++) < blocks; )
+               {
+                 seed_seq seq{ seed, (unsigned) b, (unsigned) (b>>32) };
+                 re.seed(seq);
+
+                 long end = min(N, (b+1)*blocksize);
+                 if constexpr (is_invocable_v<Body, long, long>)
+                     for (long i=b*blocksize; i<end; i+=opt.batchsize) body(i, min(end, i+opt.batchsize));
+                 else
+                     for (long i=b*blocksize; i<end; i++) body(i);
+
+                 unique_lock<mutex> lock(m);
+                 cv.wait(lock, [&]{ return merged==b || failed; });       // Merge in block order.
+                 if (failed) break;
+                 Accumulator::MergeAll(slot);
+                 merged++;
+                 if (blocks>=100 && merged % (blocks/100)==0) cout << 100.0*merged/blocks << "% done\n";
+
+                 auto now = chrono::steady_clock::now();
+                 if (!opt.checkpoint.empty() && merged<blocks && chrono::duration<double>(now-lastCheckpoint).count() > opt.interval)
+                   {
+                     WriteCheckpoint(opt.checkpoint, N, seed, blocksize, merged);
+                     lastCheckpoint = now;
+                   }
+                 cv.notify_all();
+               }
+           }
+         catch (...)
+           {
+             errors[slot] = current_exception();
+             unique_lock<mutex> lock(m);
+             failed = true;                                     // Release threads waiting for their turn.
+             next = blocks;
+             cv.notify_all();
+           }
+      };
+
+    vector<thread> workers;
+    for (int t=1; t<threads; t++) workers.push_back( thread(worker, t) );
+    worker(0);
+    for (auto& w : workers) w.join();
+    mcSlot = 0;
+
+    for (auto& e : errors) if (e) rethrow_exception(e);
+    if (!opt.checkpoint.empty()) remove(opt.checkpoint.c_str());
+}
+
+#endif
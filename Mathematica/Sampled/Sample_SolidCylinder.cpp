@@ -17,17 +17,16 @@ namespace fs = std::filesystem;
 
 using namespace std;
 
-default_random_engine re;
 #include "GenerateSamples.hpp"
 
+unsigned seed = 1;     // Set by the first command line argument, use different seeds for runs that are merged afterwards.
+
 void Sample(double R, double L)
 {
    string dir="SolidCylinder_R"+to_string(R)+"_L"+to_string(L)+"/";
    fs::create_directory(dir);
    
-   uniform_real_distribution<double> dist(-1,1);
-   uniform_real_distribution<double> unit(0,1);
-   int N = 100000000;
+   long N = 100000000;
 
    vector<double> qvec;
    double qmin=1;
@@ -65,154 +64,151 @@ void Sample(double R, double L)
   
    double Phull = Ahull/(Ahull+2*Aend);   // Area fraction of outside is [0:Pout] whereas [Pout:1] is the inner surface
    
-   for (int i=0;i<N;i++)
+   MonteCarlo(N, seed, [&](long begin, long end)
       {
-          if (i % (N/100)==0)
-                cout << 100.0*i/N << "% done\n";
-      
-         // Inside points
-         double x1,y1,z1, x2,y2,z2;         
-         RandomSolidCylinder(L, R, x1,y1,z1, dist);
-         RandomSolidCylinder(L, R, x2,y2,z2, dist);
+         Points inside1(end-begin), inside2(end-begin), end1(end-begin), end2(end-begin), hull1(end-begin), hull2(end-begin);
+         RandomSolidCylinder(L, R, inside1);
+         RandomSolidCylinder(L, R, inside2);
+         RandomCylinderEnd(L, R, end1);
+         RandomCylinderEnd(L, R, end2);
+         RandomCylinderHull(L, R, hull1);
+         RandomCylinderHull(L, R, hull2);
+
+         for (long k=0; k<end-begin; k++)
+           {
+            // Inside points
+            double x1=inside1.x[k], y1=inside1.y[k], z1=inside1.z[k];
+            double x2=inside2.x[k], y2=inside2.y[k], z2=inside2.z[k];
                 
-         // Points on the ends:
-         double xe1,ye1,ze1;
-         double xe2,ye2,ze2;
-         RandomDisk(R,xe1,ye1,ze1, dist);
-         RandomDisk(R,xe2,ye2,ze2, dist);
-
-         if (unit(re)>0.5)  ze1=L/2; else ze1=-L/2;
-         if (unit(re)>0.5)  ze2=L/2; else ze2=-L/2;
-
-         // Points on the end axis:
-         double xa1,ya1,za1;
-         double xa2,ya2,za2;
+            // Points on the ends:
+            double xe1=end1.x[k], ye1=end1.y[k], ze1=end1.z[k];
+            double xe2=end2.x[k], ye2=end2.y[k], ze2=end2.z[k];
 
-         xa1= ya1=0; za1=L/2;
-         xa2= ya2=0; za2=-L/2;
+            // Points on the end axis:
+            double xa1,ya1,za1;
+            double xa2,ya2,za2;
 
-         double xh1,yh1,zh1;
-         double xh2,yh2,zh2;
+            xa1= ya1=0; za1=L/2;
+            xa2= ya2=0; za2=-L/2;
 
-         RandomCylinderHull(L,R, xh1,yh1,zh1, dist);
-         RandomCylinderHull(L,R, xh2,yh2,zh2, dist);
+            double xh1=hull1.x[k], yh1=hull1.y[k], zh1=hull1.z[k];
+            double xh2=hull2.x[k], yh2=hull2.y[k], zh2=hull2.z[k];
 
-         // Random points inside shell
-         FF.add(x1-x2,y1-y2,z1-z2);
+            // Random points inside shell
+            FF.add(x1-x2,y1-y2,z1-z2);
 
-         // Form factor amplitudes
+            // Form factor amplitudes
          
-         // Center to scatterer
-         FFA_center.add(x1,y1,z1);
-         FFA_center.add(x2,y2,z2);
+            // Center to scatterer
+            FFA_center.add(x1,y1,z1);
+            FFA_center.add(x2,y2,z2);
          
-         // Ends to scatterer
-         FFA_end.add(x1-xe1,y1-ye1,z1-ze1);
-         FFA_end.add(x2-xe1,y2-ye1,z2-ze1);
-         FFA_end.add(x1-xe2,y1-ye2,z1-ze2);
-         FFA_end.add(x2-xe2,y2-ye2,z2-ze2);
-
-         // hull to scatterer
-         FFA_hull.add(x1-xh1,y1-yh1,z1-zh1);
-         FFA_hull.add(x2-xh1,y2-yh1,z2-zh1);
-         FFA_hull.add(x1-xh2,y1-yh2,z1-zh2);
-         FFA_hull.add(x2-xh2,y2-yh2,z2-zh2);
-
-         // Axis points as the end
-         FFA_point.add(x1-xa1,y1-ya1,z1-za1);
-         FFA_point.add(x1-xa2,y1-ya2,z1-za2);
-         FFA_point.add(x2-xa1,y2-ya1,z2-za1);
-         FFA_point.add(x2-xa2,y2-ya2,z2-za2);
-
-         // Any surface to scatterer
-         if (unit(re)<Phull)   FFA_surface.add( x1-xh1,y1-yh1,z1-zh1 );  // Hull
-                         else  FFA_surface.add( x1-xe1,y1-ye1,z1-ze1 );  // ends
-
-         if (unit(re)<Phull)   FFA_surface.add( x2-xh2,y2-yh2,z2-zh2 );  // Hull
-                         else  FFA_surface.add( x2-xe2,y2-ye2,z2-ze2 );  // ends
-
-         if (unit(re)<Phull)   FFA_surface.add( x2-xh1,y2-yh1,z2-zh1 );  // Hull
-                         else  FFA_surface.add( x2-xe1,y2-ye1,z2-ze1 );  // ends
-
-         if (unit(re)<Phull)   FFA_surface.add( x1-xh2,y1-yh2,z1-zh2 );  // Hull
-                         else  FFA_surface.add( x1-xe2,y1-ye2,z1-ze2 );  // ends
-
-
-         // Phase factors
+            // Ends to scatterer
+            FFA_end.add(x1-xe1,y1-ye1,z1-ze1);
+            FFA_end.add(x2-xe1,y2-ye1,z2-ze1);
+            FFA_end.add(x1-xe2,y1-ye2,z1-ze2);
+            FFA_end.add(x2-xe2,y2-ye2,z2-ze2);
+
+            // hull to scatterer
+            FFA_hull.add(x1-xh1,y1-yh1,z1-zh1);
+            FFA_hull.add(x2-xh1,y2-yh1,z2-zh1);
+            FFA_hull.add(x1-xh2,y1-yh2,z1-zh2);
+            FFA_hull.add(x2-xh2,y2-yh2,z2-zh2);
+
+            // Axis points as the end
+            FFA_point.add(x1-xa1,y1-ya1,z1-za1);
+            FFA_point.add(x1-xa2,y1-ya2,z1-za2);
+            FFA_point.add(x2-xa1,y2-ya1,z2-za1);
+            FFA_point.add(x2-xa2,y2-ya2,z2-za2);
+
+            // Any surface to scatterer
+            if (Uniform()<Phull)   FFA_surface.add( x1-xh1,y1-yh1,z1-zh1 );  // Hull
+                            else  FFA_surface.add( x1-xe1,y1-ye1,z1-ze1 );  // ends
+
+            if (Uniform()<Phull)   FFA_surface.add( x2-xh2,y2-yh2,z2-zh2 );  // Hull
+                            else  FFA_surface.add( x2-xe2,y2-ye2,z2-ze2 );  // ends
+
+            if (Uniform()<Phull)   FFA_surface.add( x2-xh1,y2-yh1,z2-zh1 );  // Hull
+                            else  FFA_surface.add( x2-xe1,y2-ye1,z2-ze1 );  // ends
+
+            if (Uniform()<Phull)   FFA_surface.add( x1-xh2,y1-yh2,z1-zh2 );  // Hull
+                            else  FFA_surface.add( x1-xe2,y1-ye2,z1-ze2 );  // ends
+
+            // Phase factors
                            
-         PF_center_hull.add( xh1,yh1,zh1);
-         PF_center_hull.add( xh1,yh1,zh1);
+            PF_center_hull.add( xh1,yh1,zh1);
+            PF_center_hull.add( xh1,yh1,zh1);
 
-         PF_center_end.add( xe1,ye1,ze1);
-         PF_center_end.add( xe2,ye2,ze2);
+            PF_center_end.add( xe1,ye1,ze1);
+            PF_center_end.add( xe2,ye2,ze2);
 
-         if (unit(re)<Phull)   PF_center_surface.add( xh1,yh1,zh1);  // Hull
-                         else  PF_center_surface.add( xe1,ye1,ze1);  // ends
+            if (Uniform()<Phull)   PF_center_surface.add( xh1,yh1,zh1);  // Hull
+                            else  PF_center_surface.add( xe1,ye1,ze1);  // ends
 
-         if (unit(re)<Phull)   PF_center_surface.add( xh2,yh2,zh2);  // Hull
-                         else  PF_center_surface.add( xe2,ye2,ze2);  // ends
+            if (Uniform()<Phull)   PF_center_surface.add( xh2,yh2,zh2);  // Hull
+                            else  PF_center_surface.add( xe2,ye2,ze2);  // ends
          
-         // end2end
-         PF_end_end.add( xe2-xe1,ye2-ye1,ze2-ze1);                  
+            // end2end
+            PF_end_end.add( xe2-xe1,ye2-ye1,ze2-ze1);                  
          
-         // end2hull
-         PF_end_hull.add( xe1-xh1,ye1-yh1,ze1-zh1);
-         PF_end_hull.add( xe1-xh2,ye1-yh2,ze1-zh2);
-         PF_end_hull.add( xe2-xh2,ye2-yh2,ze2-zh2);
-         PF_end_hull.add( xe2-xh1,ye2-yh1,ze2-zh1);
-
-         // end to axis point
-         PF_end_point.add(xe1-xa1,ye1-ya1,ze1-za1);
-         PF_end_point.add(xe2-xa1,ye2-ya1,ze2-za1);
-         PF_end_point.add(xe1-xa2,ye1-ya2,ze1-za2);
-         PF_end_point.add(xe2-xa2,ye2-ya2,ze2-za2);
-
-
-         // end2surface
-         if (unit(re)<Phull)   PF_end_surface.add( xe1-xh1,ye1-yh1,ze1-zh1 );  // Hull
-                         else  PF_end_surface.add( xe1-xe2,ye1-ye2,ze1-ze2 );  // ends
+            // end2hull
+            PF_end_hull.add( xe1-xh1,ye1-yh1,ze1-zh1);
+            PF_end_hull.add( xe1-xh2,ye1-yh2,ze1-zh2);
+            PF_end_hull.add( xe2-xh2,ye2-yh2,ze2-zh2);
+            PF_end_hull.add( xe2-xh1,ye2-yh1,ze2-zh1);
+
+            // end to axis point
+            PF_end_point.add(xe1-xa1,ye1-ya1,ze1-za1);
+            PF_end_point.add(xe2-xa1,ye2-ya1,ze2-za1);
+            PF_end_point.add(xe1-xa2,ye1-ya2,ze1-za2);
+            PF_end_point.add(xe2-xa2,ye2-ya2,ze2-za2);
+
+            // end2surface
+            if (Uniform()<Phull)   PF_end_surface.add( xe1-xh1,ye1-yh1,ze1-zh1 );  // Hull
+                            else  PF_end_surface.add( xe1-xe2,ye1-ye2,ze1-ze2 );  // ends
  
-         // hull2hull
-         PF_hull_hull.add( xh2-xh1,yh2-yh1,zh2-zh1);
-
-         // hull to axis point
-         PF_hull_point.add(xh1-xa1,yh1-ya1,zh1-za1);
-         PF_hull_point.add(xh2-xa1,yh2-ya1,zh2-za1);
-         PF_hull_point.add(xh1-xa2,yh1-ya2,zh1-za2);
-         PF_hull_point.add(xh2-xa2,yh2-ya2,zh2-za2);
-
-         
-         // hull2surface
-         if (unit(re)<Phull)   PF_hull_surface.add( xh2-xh1,yh2-yh1,zh2-zh1 );  // Hull
-                         else  PF_hull_surface.add( xe1-xh1,ye1-yh1,ze1-zh1 );  // ends
-
-
-         // axis point 2 surface
-         if (unit(re)<Phull)   PF_point_surface.add( xh1-xa1,yh1-ya1,zh1-za1 );  // Hull
-                         else  PF_point_surface.add( xe1-xa1,ye1-ya1,ze1-za1 );  // ends
-
-         if (unit(re)<Phull)   PF_point_surface.add( xh2-xa1,yh2-ya1,zh2-za1 );  // Hull
-                         else  PF_point_surface.add( xe2-xa1,ye2-ya1,ze2-za1 );  // ends
-
-         if (unit(re)<Phull)   PF_point_surface.add( xh1-xa2,yh1-ya2,zh1-za2 );  // Hull
-                         else  PF_point_surface.add( xe1-xa2,ye1-ya2,ze1-za2 );  // ends
-
-         if (unit(re)<Phull)   PF_point_surface.add( xh2-xa2,yh2-ya2,zh2-za2 );  // Hull
-                         else  PF_point_surface.add( xe2-xa2,ye2-ya2,ze2-za2 );  // ends
-
-         // surface2surface
-         bool s1=unit(re)<Phull;
-         bool s2=unit(re)<Phull;
-         if (s1 && s2)   PF_surface_surface.add( xh2-xh1,yh2-yh1,zh2-zh1 );  // Hull 2 hull
-         if (!s1 && s2)  PF_surface_surface.add( xe2-xh1,ye2-yh1,ze2-zh1 );  // end 2 hull
-         if (s1 && !s2)  PF_surface_surface.add( xh2-xe1,yh2-ye1,zh2-ze1 );  // Hull 2 end
-         if (!s1 && !s2) PF_surface_surface.add( xe2-xe1,ye2-ye1,ze2-ze1 );  // end 2 end        
-      }
+            // hull2hull
+            PF_hull_hull.add( xh2-xh1,yh2-yh1,zh2-zh1);
+
+            // hull to axis point
+            PF_hull_point.add(xh1-xa1,yh1-ya1,zh1-za1);
+            PF_hull_point.add(xh2-xa1,yh2-ya1,zh2-za1);
+            PF_hull_point.add(xh1-xa2,yh1-ya2,zh1-za2);
+            PF_hull_point.add(xh2-xa2,yh2-ya2,zh2-za2);
+
+            // hull2surface
+            if (Uniform()<Phull)   PF_hull_surface.add( xh2-xh1,yh2-yh1,zh2-zh1 );  // Hull
+                            else  PF_hull_surface.add( xe1-xh1,ye1-yh1,ze1-zh1 );  // ends
+
+            // axis point 2 surface
+            if (Uniform()<Phull)   PF_point_surface.add( xh1-xa1,yh1-ya1,zh1-za1 );  // Hull
+                            else  PF_point_surface.add( xe1-xa1,ye1-ya1,ze1-za1 );  // ends
+
+            if (Uniform()<Phull)   PF_point_surface.add( xh2-xa1,yh2-ya1,zh2-za1 );  // Hull
+                            else  PF_point_surface.add( xe2-xa1,ye2-ya1,ze2-za1 );  // ends
+
+            if (Uniform()<Phull)   PF_point_surface.add( xh1-xa2,yh1-ya2,zh1-za2 );  // Hull
+                            else  PF_point_surface.add( xe1-xa2,ye1-ya2,ze1-za2 );  // ends
+
+            if (Uniform()<Phull)   PF_point_surface.add( xh2-xa2,yh2-ya2,zh2-za2 );  // Hull
+                            else  PF_point_surface.add( xe2-xa2,ye2-ya2,ze2-za2 );  // ends
+
+            // surface2surface
+            bool s1=Uniform()<Phull;
+            bool s2=Uniform()<Phull;
+            if (s1 && s2)   PF_surface_surface.add( xh2-xh1,yh2-yh1,zh2-zh1 );  // Hull 2 hull
+            if (!s1 && s2)  PF_surface_surface.add( xe2-xh1,ye2-yh1,ze2-zh1 );  // end 2 hull
+            if (s1 && !s2)  PF_surface_surface.add( xh2-xe1,yh2-ye1,zh2-ze1 );  // Hull 2 end
+            if (!s1 && !s2) PF_surface_surface.add( xe2-xe1,ye2-ye1,ze2-ze1 );  // end 2 end        
+           }
+      }, {.checkpoint = dir+"checkpoint"});
 
 }
 
-int main()
+int main(int argc, char** argv)
 {
+   if (argc>1) seed=atoi(argv[1]);
+
     Sample(2.0,0.5);
     Sample(1.0,1.5);
 }
@@ -16,19 +16,16 @@ namespace fs = std::filesystem;
 
 using namespace std;
 
-default_random_engine re;
-uniform_real_distribution<double> unit(0,1);
-
 #include "GenerateSamples.hpp"
 
+unsigned seed = 1;     // Set by the first command line argument, use different seeds for runs that are merged afterwards.
+
 void Sample(double Ri, double Ro)
 {
    string dir="SolidSphericalShell_Ri"+to_string(Ri)+"_Ro"+to_string(Ro)+"/";
    fs::create_directory(dir);
 
-   uniform_real_distribution<double> dist(-Ro,Ro);
- 
-   int N = 100000000;
+   long N = 100000000;
   
    vector<double> qvec;
    double qmin=0.1;
@@ -56,91 +53,94 @@ void Sample(double Ri, double Ro)
   
    double Pout = Ro*Ro/(Ri*Ri+Ro*Ro);   // Area fraction of outside is [0:Pout] whereas [Pout:1] is the inner surface
    
-   for (int i=0;i<N;i++)
+   MonteCarlo(N, seed, [&](long begin, long end)
       {
-          if (i % (N/100)==0)
-                cout << 100.0*i/N << "% done\n";
-      
-         double x1,y1,z1, x2,y2,z2;
+         Points inside1(end-begin), inside2(end-begin), inner1(end-begin), inner2(end-begin), outer1(end-begin), outer2(end-begin);
+         RandomSolidShell(Ri,Ro, inside1);
+         RandomSolidShell(Ri,Ro, inside2);
+         RandomSurface(Ri, inner1);
+         RandomSurface(Ri, inner2);
+         RandomSurface(Ro, outer1);
+         RandomSurface(Ro, outer2);
+
+         for (long k=0; k<end-begin; k++)
+           {
          
-         RandomSolidShell(Ri,Ro, x1,y1,z1, dist);
-         RandomSolidShell(Ri,Ro, x2,y2,z2, dist);
+            double x1=inside1.x[k], y1=inside1.y[k], z1=inside1.z[k];
+            double x2=inside2.x[k], y2=inside2.y[k], z2=inside2.z[k];
          
-         double xi1,yi1,zi1, xi2,yi2,zi2;
-         double xo1,yo1,zo1, xo2,yo2,zo2;
-         
-         RandomSurface(Ri, xi1,yi1,zi1, dist);
-         RandomSurface(Ri, xi2,yi2,zi2, dist);
-         RandomSurface(Ro, xo1,yo1,zo1, dist);
-         RandomSurface(Ro, xo2,yo2,zo2, dist);
+            double xi1=inner1.x[k], yi1=inner1.y[k], zi1=inner1.z[k];
+            double xi2=inner2.x[k], yi2=inner2.y[k], zi2=inner2.z[k];
+            double xo1=outer1.x[k], yo1=outer1.y[k], zo1=outer1.z[k];
+            double xo2=outer2.x[k], yo2=outer2.y[k], zo2=outer2.z[k];
 
-         // Random points inside shell
-         FF.add(x1-x2,y1-y2,z1-z2);
+            // Random points inside shell
+            FF.add(x1-x2,y1-y2,z1-z2);
 
-         // Form factor amplitudes
+            // Form factor amplitudes
          
-         // Center to scatterer
-         FFAcenter.add(x1,y1,z1);
-         FFAcenter.add(x2,y2,z2);
+            // Center to scatterer
+            FFAcenter.add(x1,y1,z1);
+            FFAcenter.add(x2,y2,z2);
          
-         // Inner surface to scatterer
-         FFAinner.add(x1-xi1,y1-yi1,z1-zi1);
-         FFAinner.add(x2-xi1,y2-yi1,z2-zi1);
-         FFAinner.add(x1-xi2,y1-yi2,z1-zi2);
-         FFAinner.add(x2-xi2,y2-yi2,z2-zi2);
-
-         // Outer surface to scatterer
-         FFAouter.add(x1-xo1,y1-yo1,z1-zo1);
-         FFAouter.add(x2-xo1,y2-yo1,z2-zo1);
-         FFAouter.add(x1-xo2,y1-yo2,z1-zo2);
-         FFAouter.add(x2-xo2,y2-yo2,z2-zo2);
-
-         // Any surface to scatterer
-         double r=unit(re);
-         if (r<Pout)   FFAsurface.add( x1-xo1,y1-yo1,z1-zo1 );
-                 else  FFAsurface.add( x1-xi1,y1-yi1,z1-zi1 );
-
-         r=unit(re);
-         if (r<Pout)   FFAsurface.add( x2-xo2,y2-yo2,z2-zo2 );
-                 else  FFAsurface.add( x2-xi2,y2-yi2,z2-zi2 );
-
-
-         // Phase factors
+            // Inner surface to scatterer
+            FFAinner.add(x1-xi1,y1-yi1,z1-zi1);
+            FFAinner.add(x2-xi1,y2-yi1,z2-zi1);
+            FFAinner.add(x1-xi2,y1-yi2,z1-zi2);
+            FFAinner.add(x2-xi2,y2-yi2,z2-zi2);
+
+            // Outer surface to scatterer
+            FFAouter.add(x1-xo1,y1-yo1,z1-zo1);
+            FFAouter.add(x2-xo1,y2-yo1,z2-zo1);
+            FFAouter.add(x1-xo2,y1-yo2,z1-zo2);
+            FFAouter.add(x2-xo2,y2-yo2,z2-zo2);
+
+            // Any surface to scatterer
+            double r=Uniform();
+            if (r<Pout)   FFAsurface.add( x1-xo1,y1-yo1,z1-zo1 );
+                    else  FFAsurface.add( x1-xi1,y1-yi1,z1-zi1 );
+
+            r=Uniform();
+            if (r<Pout)   FFAsurface.add( x2-xo2,y2-yo2,z2-zo2 );
+                    else  FFAsurface.add( x2-xi2,y2-yi2,z2-zi2 );
+
+            // Phase factors
          
-         Psi_inner_inner.add( xi2-xi1,yi2-yi1,zi2-zi1);
-         Psi_outer_outer.add( xo2-xo1,yo2-yo1,zo2-zo1);
-
-         Psi_inner_outer.add( xo1-xi1,yo1-yi1,zo1-zi1);
-         Psi_inner_outer.add( xo2-xi2,yo2-yi2,zo2-zi2);
-
-         r=unit(re);
-         if (r<Pout)   Psi_center_surface.add( xo1,yo1,zo1 );
-                 else  Psi_center_surface.add( xi1,yi1,zi1 );
-
-         r=unit(re);
-         if (r<Pout)   Psi_center_surface.add( xo2,yo2,zo2 );
-                 else  Psi_center_surface.add( xi2,yi2,zi2 );
-
-
-         r=unit(re);
-         if (r<Pout)   Psi_inner_surface.add( xo1-xi1,yo1-yi1,zo1-zi1 );
-                 else  Psi_inner_surface.add( xi2-xi1,yi2-yi1,zi2-zi1 );
-
-         r=unit(re);
-         if (r<Pout)   Psi_outer_surface.add( xo2-xo1,yo2-yo1,zo2-zo1 );
-                 else  Psi_outer_surface.add( xi2-xo1,yi2-yo1,zi2-zo1 );
-
-
-         double r1=unit(re);
-         double r2=unit(re);
-         if (r1<Pout && r2<Pout)   Psi_surface_surface.add( xo2-xo1,yo2-yo1,zo2-zo1 );    // 1 and 2 are outside
-         if (r1<Pout && r2>Pout)   Psi_surface_surface.add( xi2-xo1,yi2-yo1,zi2-zo1 );    // 1 is outside, 2 is inside
-         if (r1>Pout && r2<Pout)   Psi_surface_surface.add( xo2-xi1,yo2-yi1,zo2-zi1 );    // 2 is outside, 1 is inside
-         if (r1>Pout && r2>Pout)   Psi_surface_surface.add( xi2-xi1,yi2-yi1,zi2-zi1 );    // 1 and 2 are inside
-      }
+            Psi_inner_inner.add( xi2-xi1,yi2-yi1,zi2-zi1);
+            Psi_outer_outer.add( xo2-xo1,yo2-yo1,zo2-zo1);
+
+            Psi_inner_outer.add( xo1-xi1,yo1-yi1,zo1-zi1);
+            Psi_inner_outer.add( xo2-xi2,yo2-yi2,zo2-zi2);
+
+            r=Uniform();
+            if (r<Pout)   Psi_center_surface.add( xo1,yo1,zo1 );
+                    else  Psi_center_surface.add( xi1,yi1,zi1 );
+
+            r=Uniform();
+            if (r<Pout)   Psi_center_surface.add( xo2,yo2,zo2 );
+                    else  Psi_center_surface.add( xi2,yi2,zi2 );
+
+            r=Uniform();
+            if (r<Pout)   Psi_inner_surface.add( xo1-xi1,yo1-yi1,zo1-zi1 );
+                    else  Psi_inner_surface.add( xi2-xi1,yi2-yi1,zi2-zi1 );
+
+            r=Uniform();
+            if (r<Pout)   Psi_outer_surface.add( xo2-xo1,yo2-yo1,zo2-zo1 );
+                    else  Psi_outer_surface.add( xi2-xo1,yi2-yo1,zi2-zo1 );
+
+            double r1=Uniform();
+            double r2=Uniform();
+            if (r1<Pout && r2<Pout)   Psi_surface_surface.add( xo2-xo1,yo2-yo1,zo2-zo1 );    // 1 and 2 are outside
+            if (r1<Pout && r2>Pout)   Psi_surface_surface.add( xi2-xo1,yi2-yo1,zi2-zo1 );    // 1 is outside, 2 is inside
+            if (r1>Pout && r2<Pout)   Psi_surface_surface.add( xo2-xi1,yo2-yi1,zo2-zi1 );    // 2 is outside, 1 is inside
+            if (r1>Pout && r2>Pout)   Psi_surface_surface.add( xi2-xi1,yi2-yi1,zi2-zi1 );    // 1 and 2 are inside
+           }
+      }, {.checkpoint = dir+"checkpoint"});
 }
 
-int main()
+int main(int argc, char** argv)
 {
+   if (argc>1) seed=atoi(argv[1]);
+
     Sample(2.33,3.44);
 }
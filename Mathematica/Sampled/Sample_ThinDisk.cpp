@@ -5,6 +5,7 @@
 
 */ 
 
+#include <cstdlib>
 #include <iostream>
 #include <random>
 #include "DebyeSampler.hpp"
@@ -12,15 +13,16 @@
 using namespace std;
 
 double R=1;
-default_random_engine re;
-uniform_real_distribution<double> dist(-R,R);
-uniform_real_distribution<double> unit(0,1);
 
 #include "GenerateSamples.hpp"
 
-int main()
+unsigned seed = 1;     // Set by the first command line argument, use different seeds for runs that are merged afterwards.
+
+int main(int argc, char** argv)
 {
-   int N = 100000000;
+   if (argc>1) seed=atoi(argv[1]);
+
+   long N = 100000000;
    
    vector<double> qvec;
    double qmin=0.1;
@@ -39,38 +41,41 @@ int main()
    Sampler FFArim(qvec,    "ThinDisk_R1/FFA_rim.q" );
    Sampler Prim2rim(qvec,  "ThinDisk_R1/P_rim2rim.q" );
      
-   for (int i=0;i<N;i++)
+   MonteCarlo(N, seed, [&](long begin, long end)
       {
-          if (i % (N/100)==0)
-                cout << 100.0*i/N << "% done\n";
-
-         // Two points on the surface of the spherical disk      
-         double x1,y1,z1, x2,y2,z2;
-         
-         RandomDisk(R,x1,y1,z1, dist);
-         RandomDisk(R,x2,y2,z2, dist);
-
-         // Two points on the spherical rim
-         double rx1,ry1,rz1, rx2,ry2,rz2;
-         RandomCircle(R,rx1,ry1,rz1, dist);
-         RandomCircle(R,rx2,ry2,rz2, dist);
-
-         // Form factor is the pair distance
-         FF.add(x1-x2,y1-y2,z1-z2);
-
-         // Form factor amplitudes         
-         // Center to scatterer
-         FFAcenter.add(x1,y1,z1);
-         FFAcenter.add(x2,y2,z2);
-
-         // Rim to scatterer
-         FFArim.add(x1-rx1,y1-ry1,z1-rz1);
-         FFArim.add(x2-rx2,y2-ry2,z2-rz2);
-         FFArim.add(x1-rx2,y1-ry2,z1-rz2);
-         FFArim.add(x2-rx1,y2-ry1,z2-rz1);
-
-         // Rim to rim
-         Prim2rim.add(rx2-rx1,ry2-ry1,rz2-rz1);
-      }
+         Points disk1(end-begin), disk2(end-begin), rim1(end-begin), rim2(end-begin);
+         RandomDisk(R, disk1);
+         RandomDisk(R, disk2);
+         RandomCircle(R, rim1);
+         RandomCircle(R, rim2);
+
+         for (long k=0; k<end-begin; k++)
+           {
+            // Two points on the surface of the spherical disk
+            double x1=disk1.x[k], y1=disk1.y[k], z1=disk1.z[k];
+            double x2=disk2.x[k], y2=disk2.y[k], z2=disk2.z[k];
+
+            // Two points on the spherical rim
+            double rx1=rim1.x[k], ry1=rim1.y[k], rz1=rim1.z[k];
+            double rx2=rim2.x[k], ry2=rim2.y[k], rz2=rim2.z[k];
+
+            // Form factor is the pair distance
+            FF.add(x1-x2,y1-y2,z1-z2);
+
+            // Form factor amplitudes         
+            // Center to scatterer
+            FFAcenter.add(x1,y1,z1);
+            FFAcenter.add(x2,y2,z2);
+
+            // Rim to scatterer
+            FFArim.add(x1-rx1,y1-ry1,z1-rz1);
+            FFArim.add(x2-rx2,y2-ry2,z2-rz2);
+            FFArim.add(x1-rx2,y1-ry2,z1-rz2);
+            FFArim.add(x2-rx1,y2-ry1,z2-rz1);
+
+            // Rim to rim
+            Prim2rim.add(rx2-rx1,ry2-ry1,rz2-rz1);
+           }
+      }, {.checkpoint = "ThinDisk_R1/checkpoint"});
 
 }
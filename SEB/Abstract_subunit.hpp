@@ -38,6 +38,10 @@ class ABSSubUnit{
     /*Pointer to symbol interface*/
     SymbolInterface *GLEX;
 
+    /* Allocated in the pool of a world rather than by new, and hence released by the world's pool. */
+    bool pooled = false;
+    friend class World;
+
     public:
     /*Constructor*/    
     ABSSubUnit( ){    
@@ -0,0 +1,184 @@
+/*
+    Adaptive sampling of scattering curves. See AdaptiveGrid.hpp.
+*/
+
+#include "AdaptiveGrid.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+
+
+/*
+    Piecewise cubic Hermite interpolation through (x,y) evaluated at t. Slopes are weighted three point
+    derivatives, which works for non-uniformly spaced points.
+*/
+
+static double slope(const DoubleVector& x, const DoubleVector& y, size_t i)
+{
+    size_t n = x.size();
+    if (n<2) return 0;
+    if (i==0)   return (y[1]-y[0])/(x[1]-x[0]);
+    if (i==n-1) return (y[n-1]-y[n-2])/(x[n-1]-x[n-2]);
+
+    double h0 = x[i]-x[i-1], h1 = x[i+1]-x[i];
+    double d0 = (y[i]-y[i-1])/h0, d1 = (y[i+1]-y[i])/h1;
+    return (h1*d0+h0*d1)/(h0+h1);
+}
+
+static double hermite(const DoubleVector& x, const DoubleVector& y, double t)
+{
+    size_t n = x.size();
+    if (n==1) return y[0];
+
+    size_t i = upper_bound(x.begin(), x.end(), t)-x.begin();
+    i = min(max(i, (size_t) 1), n-1)-1;          // interval [x_i : x_i+1]
+
+    double h = x[i+1]-x[i];
+    double s = (t-x[i])/h;
+    double h00 = (1+2*s)*(1-s)*(1-s), h10 = s*(1-s)*(1-s), h01 = s*s*(3-2*s), h11 = s*s*(s-1);
+
+    return h00*y[i]+h10*h*slope(x, y, i)+h01*y[i+1]+h11*h*slope(x, y, i+1);
+}
+
+// Transform sampled points into interpolation coordinates.
+static void transform(const DoubleVector& q, const DoubleVector& I, bool logI, DoubleVector& x, DoubleVector& y)
+{
+    x.resize(q.size());
+    y.resize(q.size());
+    for (size_t i=0; i<q.size(); i++)
+      {
+        x[i] = log(q[i]);
+        y[i] = logI ? log(I[i]) : I[i];
+      }
+}
+
+static bool positive(const DoubleVector& I)
+{
+    for (auto v : I) if (!(v>0)) return false;
+    return true;
+}
+
+
+void AdaptiveGrid::Sample(const std::function<DoubleVector(const DoubleVector&)>& f, double q1, double q2,
+                          double tolerance, int maxpoints, int initialpoints)
+try
+{
+    if (q2<q1) swap(q1, q2);
+    if (q1<=0)             throw SEBException("q range must be positive");
+    if (tolerance<=0)      throw SEBException("Tolerance must be positive");
+    if (initialpoints<2)   throw SEBException("At least two initial points are required");
+    if (maxpoints<initialpoints) maxpoints = initialpoints;
+
+    // Initial logarithmic grid
+    q.clear();
+    for (int i=0; i<initialpoints; i++)
+        q.push_back( q1*pow(q2/q1, double(i)/(initialpoints-1)) );
+
+    I = f(q);
+    if (I.size()!=q.size()) throw SEBException("Function returned wrong number of values");
+
+    vector<char> active(q.size()-1, true);       // active[i] is interval [q_i : q_i+1]
+
+    while ((int) q.size()<maxpoints)
+      {
+        // Midpoints of active intervals, refine the widest intervals first if we run out of points.
+        vector<size_t> intervals;
+        for (size_t i=0; i<active.size(); i++)
+           if (active[i] && q[i+1]/q[i]>1+1e-9) intervals.push_back(i);
+        if (intervals.empty()) break;
+
+        size_t room = maxpoints-q.size();
+        if (intervals.size()>room)
+          {
+            stable_sort(intervals.begin(), intervals.end(), [this](size_t a, size_t b) { return q[a+1]/q[a] > q[b+1]/q[b]; });
+            intervals.resize(room);
+            sort(intervals.begin(), intervals.end());
+          }
+
+        DoubleVector qm;
+        for (auto i : intervals) qm.push_back( sqrt(q[i]*q[i+1]) );
+
+        // One batched evaluation per round
+        DoubleVector Im = f(qm);
+        if (Im.size()!=qm.size()) throw SEBException("Function returned wrong number of values");
+
+        logI = positive(I) && positive(Im);
+        transform(q, I, logI, x, y);
+
+        double scale = 0;
+        if (!logI) for (auto v : I) scale = max(scale, fabs(v));
+
+        // Split intervals where the interpolant is not accurate, retire the rest.
+        vector<char> refine(active.size(), false);
+        for (size_t k=0; k<intervals.size(); k++)
+          {
+            size_t i = intervals[k];
+            double predicted = hermite(x, y, log(qm[k]));
+            double err = logI ? fabs(log(Im[k])-predicted) : fabs(Im[k]-predicted)/(scale>0 ? scale : 1);
+            if (err>tolerance) refine[i] = true;
+            active[i] = false;
+          }
+
+        DoubleVector nq, nI;
+        vector<char> nactive;
+        size_t k = 0;
+        for (size_t i=0; i<q.size(); i++)
+          {
+            nq.push_back(q[i]);
+            nI.push_back(I[i]);
+            if (i==q.size()-1) break;
+
+            while (k<intervals.size() && intervals[k]<i) k++;
+            if (refine[i])
+              {
+                nactive.push_back(true);
+                nq.push_back(qm[k]);
+                nI.push_back(Im[k]);
+                nactive.push_back(true);
+              }
+            else
+              nactive.push_back(active[i]);
+          }
+
+        q = nq;
+        I = nI;
+        active = nactive;
+      }
+
+    logI = positive(I);
+    transform(q, I, logI, x, y);
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("AdaptiveGrid::Sample(function, "+to_string(q1)+", "+to_string(q2)+", "+to_string(tolerance)+", "+to_string(maxpoints)+")");
+    throw;
+}
+
+double AdaptiveGrid::Interpolate(double t) const
+{
+    if (q.empty()) throw SEBException("No sampled points", "AdaptiveGrid::Interpolate(double)");
+    if (t<=0)      throw SEBException("q must be positive", "AdaptiveGrid::Interpolate("+to_string(t)+")");
+
+    double v = hermite(x, y, log(t));
+    return logI ? exp(v) : v;
+}
+
+DoubleVector AdaptiveGrid::Interpolate(const DoubleVector& t) const
+{
+    DoubleVector v(t.size());
+    for (size_t i=0; i<t.size(); i++) v[i] = Interpolate(t[i]);
+    return v;
+}
+
+void AdaptiveGrid::Save(string fname, string comment, string prefix) const
+{
+    ofstream fo(fname);
+    if (!fo.is_open()) throw SEBException("Could not open file "+fname, "AdaptiveGrid::Save("+fname+")");
+
+    fo << prefix << "File geneated by SEB\n";
+    fo << prefix << comment << "\n";
+    fo << prefix << "Adaptively sampled, " << q.size() << " points\n";
+    for (size_t i=0; i<q.size(); i++)
+        fo << q[i] << " " << I[i] << "\n";
+}
@@ -0,0 +1,64 @@
+//===========================================================================
+// Included guards
+#ifndef INCLUDE_GUARD_ADAPTIVEGRID
+#define INCLUDE_GUARD_ADAPTIVEGRID
+
+//===========================================================================
+// included dependencies
+#include <vector>
+#include <string>
+#include <functional>
+
+#include "Types.hpp"
+#include "Exceptions.hpp"
+
+//===========================================================================
+// used namespaces
+using namespace std;
+
+/*
+    AdaptiveGrid samples a function I(q) on a q grid that is refined only where needed, and provides
+    an interpolant between the sampled points.
+
+    Sampling starts from a coarse logarithmic grid. In every round the midpoints of all intervals
+    that are not yet resolved are evaluated in one batch, and compared to the interpolant through
+    the current points. Intervals where the interpolation error exceeds the tolerance are split,
+    while resolved intervals are left alone. Hence smooth regions (e.g. Guinier regimes) are sampled
+    by a few points, while oscillations (e.g. sphere minima) are resolved in detail.
+
+    The interpolant is a piecewise cubic Hermite interpolation in log q. When I(q)>0 everywhere
+    log I is interpolated, and the tolerance is the relative error, otherwise I is interpolated and
+    the tolerance is relative to max|I|.
+*/
+
+class AdaptiveGrid
+{
+private:
+
+    DoubleVector q, I;
+
+    // Interpolation coordinates x=log q, and y=log I or y=I.
+    DoubleVector x, y;
+    bool logI = true;
+
+public:
+
+    /* Sample I between q1 and q2 (both >0). I is called with a batch of q values and returns I at these.
+       tolerance is the required accuracy of the interpolant, and maxpoints limits the total number of points. */
+    void Sample(const std::function<DoubleVector(const DoubleVector&)>& I, double q1, double q2,
+                double tolerance = 1e-3, int maxpoints = 10000, int initialpoints = 17);
+
+    // Sampled points
+    const DoubleVector& getq() const { return q; }
+    const DoubleVector& getI() const { return I; }
+    int size() const { return q.size(); }
+
+    // Interpolated values.
+    double Interpolate(double x) const;
+    DoubleVector Interpolate(const DoubleVector& x) const;
+
+    // Save sampled points to a file, with comment lines starting with prefix.
+    void Save(string fname, string comment = "", string prefix = "#") const;
+};
+
+#endif // INCLUDE_GUARD_ADAPTIVEGRID
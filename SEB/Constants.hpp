@@ -28,6 +28,13 @@ enum vartypes{GENERIC=1, XVAR = 2, QVAR = 3, BETA=4, GUINIER=5, GUINIERA=6, ONE=
          SUBUNITCHILD : RWpolymer, sphere, rod, and other sub-units.
 */
 enum types{ABSSUBUNIT, STRUCTURE, SUBUNIT, SUBUNITCHILD};
+
+/* Distributions of polydisperse parameters (see Polydispersity.hpp):
+         SCHULZ     : Schulz-Zimm distribution, averaged with Gauss-Laguerre quadrature.
+         LOGNORMAL  : Log-normal distribution, averaged with Gauss-Hermite quadrature.
+         GAUSSIAN   : Normal distribution truncated at zero, averaged with Gauss-Hermite quadrature.
+*/
+enum distributions{SCHULZ, LOGNORMAL, GAUSSIAN};
     
 #endif    
 
@@ -0,0 +1,760 @@
+/*
+    Compiles scattering expressions into programs of numerical operations, and
+    evaluates them for many q values at a time. See Evaluator.hpp for usage.
+*/
+
+#include "Evaluator.hpp"
+#include "Parallel.hpp"
+
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+#include <gsl/gsl_integration.h>
+
+// Defined in SpecialFunctions.cpp
+void STVH0(double X, double *SH0);
+void STVH1(double X, double *SH1);
+
+
+/*
+    Numerical implementations of the functions that can occur in a scattering expression.
+    These mirror the evalf methods in SpecialFunctions.cpp, such that compiled and
+    GiNaC evaluated expressions agree.
+*/
+
+typedef double (*function1)(double);
+typedef double (*function2)(double, double);
+
+static double Six_double(double z)
+{
+    if (z<1e-4) return 1-z*z/18.0;
+    return gsl_sf_Si(z)/z;
+}
+
+static double StruveH0_double(double z) { double y; STVH0(z, &y); return y; }
+static double StruveH1_double(double z) { double y; STVH1(z, &y); return y; }
+
+static const map<string, function1>& Functions1()
+{
+    static const map<string, function1> f = {
+        { "sin",      [](double x) { return sin(x);  } },
+        { "cos",      [](double x) { return cos(x);  } },
+        { "tan",      [](double x) { return tan(x);  } },
+        { "exp",      [](double x) { return exp(x);  } },
+        { "log",      [](double x) { return log(x);  } },
+        { "abs",      [](double x) { return fabs(x); } },
+        { "sinh",     [](double x) { return sinh(x); } },
+        { "cosh",     [](double x) { return cosh(x); } },
+        { "tanh",     [](double x) { return tanh(x); } },
+        { "asin",     [](double x) { return asin(x); } },
+        { "acos",     [](double x) { return acos(x); } },
+        { "atan",     [](double x) { return atan(x); } },
+        { "csc",      [](double x) { return 1/sin(x); } },
+        { "sec",      [](double x) { return 1/cos(x); } },
+        { "BesselJ0", [](double x) { return gsl_sf_bessel_J0(x);    } },
+        { "BesselJ1", [](double x) { return gsl_sf_bessel_J1(x);    } },
+        { "BesselJ2", [](double x) { return gsl_sf_bessel_Jn(2, x); } },
+        { "DawsonF",  [](double x) { return gsl_sf_dawson(x);       } },
+        { "Si",       [](double x) { return gsl_sf_Si(x);           } },
+        { "Six",      Six_double },
+        { "Erf",      [](double x) { return gsl_sf_erf(x);          } },
+        { "Erfc",     [](double x) { return gsl_sf_erfc(x);         } },
+        { "StruveH0", StruveH0_double },
+        { "StruveH1", StruveH1_double } };
+    return f;
+}
+
+static const map<string, function2>& Functions2()
+{
+    static const map<string, function2> f = {
+        { "power",                        [](double x, double a) { return pow(x, a);             } },
+        { "Hypergeometric0F1Regularized", [](double a, double x) { return gsl_sf_hyperg_0F1(a, x); } } };
+    return f;
+}
+
+
+/*
+    Gauss-Legendre nodes and weights on [0:1] used by all integrals.
+*/
+
+struct GaussLegendreRule
+{
+    vector<double> x, w;
+
+    GaussLegendreRule(int n)
+    {
+        gsl_integration_glfixed_table* t = gsl_integration_glfixed_table_alloc(n);
+        x.resize(n);
+        w.resize(n);
+        for (int i=0; i<n; i++)
+            gsl_integration_glfixed_point(0.0, 1.0, i, &x[i], &w[i], t);
+        gsl_integration_glfixed_table_free(t);
+    }
+};
+
+static const GaussLegendreRule& PanelRule()
+{
+    static const GaussLegendreRule rule(16);
+    return rule;
+}
+
+
+/*
+    Helpers for dependency bit masks.
+*/
+
+static void maskMerge(vector<uint64_t>& a, const vector<uint64_t>& b)
+{
+    if (a.size()<b.size()) a.resize(b.size(), 0);
+    for (size_t i=0; i<b.size(); i++) a[i] |= b[i];
+}
+
+static bool maskIntersects(const vector<uint64_t>& a, const vector<uint64_t>& b)
+{
+    size_t n = min(a.size(), b.size());
+    for (size_t i=0; i<n; i++) if (a[i] & b[i]) return true;
+    return false;
+}
+
+static bool maskHas(const vector<uint64_t>& a, int bit)
+{
+    size_t w = bit/64;
+    return w<a.size() && (a[w]>>(bit%64) & 1);
+}
+
+static void maskSet(vector<uint64_t>& a, int bit)
+{
+    size_t w = bit/64;
+    if (a.size()<=w) a.resize(w+1, 0);
+    a[w] |= (uint64_t(1) << (bit%64));
+}
+
+static void maskClear(vector<uint64_t>& a, int bit)
+{
+    size_t w = bit/64;
+    if (w<a.size()) a[w] &= ~(uint64_t(1) << (bit%64));
+}
+
+static string to_string_ex(const ex& e)
+{
+    ostringstream os;
+    os << e;
+    return os.str();
+}
+
+
+/*
+    Compilation
+*/
+
+int Evaluator::getVariable(const ex& s)
+{
+    auto it = variableIndex.find(s);
+    if (it!=variableIndex.end()) return it->second;
+
+    int i = variables.size();
+    variables.push_back(s);
+    variableIndex[s] = i;
+    integrationVariable.push_back(false);
+    return i;
+}
+
+int Evaluator::addNode(int p, const ex& e, EvaluatorNode& node, vector<uint64_t>& mask)
+{
+    EvaluatorProgram& prog = programs[p];
+    int n = prog.nodes.size();
+    prog.nodes.push_back(node);
+    prog.depends.push_back(mask);
+    prog.memo[e] = n;
+    return n;
+}
+
+int Evaluator::CompileNode(const ex& e, int p)
+{
+    {
+      auto it = programs[p].memo.find(e);
+      if (it!=programs[p].memo.end()) return it->second;
+    }
+
+    // NB. programs may be reallocated by nested integrals, so never hold references across recursive calls.
+    EvaluatorNode node;
+    vector<uint64_t> mask;
+
+    if (is_a<numeric>(e))
+      {
+        const numeric& x = ex_to<numeric>(e);
+        if (!x.is_real()) throw SEBException("Complex number "+to_string_ex(e)+" in expression");
+        node.op = OPCONSTANT;
+        node.value = x.to_double();
+      }
+    else if (is_a<constant>(e))
+      {
+        ex x = e.evalf();
+        if (!is_a<numeric>(x)) throw SEBException("Constant "+to_string_ex(e)+" did not evaluate to a number");
+        node.op = OPCONSTANT;
+        node.value = ex_to<numeric>(x).to_double();
+      }
+    else if (is_a<symbol>(e))
+      {
+        node.op = OPVARIABLE;
+        node.index = getVariable(e);
+        maskSet(mask, node.index);
+      }
+    else if (is_a<add>(e) || is_a<mul>(e))
+      {
+        node.op = is_a<add>(e) ? OPADD : OPMUL;
+        for (size_t i=0; i<e.nops(); i++)
+           {
+             int a = CompileNode(e.op(i), p);
+             node.args.push_back(a);
+             maskMerge(mask, programs[p].depends[a]);
+           }
+      }
+    else if (is_a<GiNaC::power>(e))
+      {
+        ex base = e.op(0), expo = e.op(1);
+        int b = CompileNode(base, p);
+        node.args.push_back(b);
+        maskMerge(mask, programs[p].depends[b]);
+
+        if (is_a<numeric>(expo) && ex_to<numeric>(expo).is_integer())
+          {
+            node.op = OPPOWINT;
+            node.index = ex_to<numeric>(expo).to_int();
+          }
+        else if (is_a<numeric>(expo) && ex_to<numeric>(expo).is_real() && ex_to<numeric>(expo).to_double()==0.5)
+          {
+            node.op = OPSQRT;
+          }
+        else
+          {
+            node.op = OPPOW;
+            int a = CompileNode(expo, p);
+            node.args.push_back(a);
+            maskMerge(mask, programs[p].depends[a]);
+          }
+      }
+    else if (is_a<GiNaC::function>(e))
+      {
+        string name = ex_to<GiNaC::function>(e).get_name();
+        if (e.nops()==1 && Functions1().count(name))
+          {
+            node.op = OPFUNCTION1;
+            node.f1 = Functions1().at(name);
+          }
+        else if (e.nops()==2 && Functions2().count(name))
+          {
+            node.op = OPFUNCTION2;
+            node.f2 = Functions2().at(name);
+          }
+        else
+          throw SEBException("Function "+name+" can not be evaluated numerically");
+
+        for (size_t i=0; i<e.nops(); i++)
+           {
+             int a = CompileNode(e.op(i), p);
+             node.args.push_back(a);
+             maskMerge(mask, programs[p].depends[a]);
+           }
+      }
+    else if (is_a<integral>(e))
+      {
+        // integral(x, a, b, f)
+        if (!is_a<symbol>(e.op(0))) throw SEBException("Integration variable is not a symbol in "+to_string_ex(e));
+
+        node.op = OPINTEGRAL;
+        node.index = getVariable(e.op(0));
+        integrationVariable[node.index] = true;
+
+        for (int i=1; i<=2; i++)
+           {
+             int a = CompileNode(e.op(i), p);
+             node.args.push_back(a);
+             maskMerge(mask, programs[p].depends[a]);
+           }
+
+        int sub = programs.size();
+        programs.push_back(EvaluatorProgram());
+        int out = CompileNode(e.op(3), sub);
+        programs[sub].output = out;
+        node.program = sub;
+
+        vector<uint64_t> fmask = programs[sub].depends[out];
+        maskClear(fmask, node.index);
+        maskMerge(mask, fmask);
+      }
+    else
+      throw SEBException("Can not evaluate "+to_string_ex(e)+" numerically");
+
+    return addNode(p, e, node, mask);
+}
+
+int Evaluator::Compile(const ex& expr)
+try
+{
+    if (programs.empty()) programs.push_back(EvaluatorProgram());
+
+    outputs.push_back( CompileNode(expr, 0) );
+    return outputs.size()-1;
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Evaluator::Compile(ex)");
+    throw;
+}
+
+int Evaluator::NumberOfNodes() const
+{
+    int n = 0;
+    for (auto& p : programs) n += p.nodes.size();
+    return n;
+}
+
+exset Evaluator::Symbols() const
+{
+    exset s;
+    for (size_t i=0; i<variables.size(); i++)
+       if (!integrationVariable[i]) s.insert(variables[i]);
+    return s;
+}
+
+bool Evaluator::DependsOn(int k, const ex& s) const
+{
+    auto it = variableIndex.find(s);
+    if (it==variableIndex.end()) return false;
+    return maskHas(programs[0].depends[outputs.at(k)], it->second);
+}
+
+
+/*
+    Workspaces and variables
+*/
+
+void Evaluator::Prepare(EvaluatorWorkspace& ws, int lanes) const
+{
+    if (lanes<1) throw SEBException("Number of lanes must be positive", "Evaluator::Prepare(EvaluatorWorkspace&, "+to_string(lanes)+")");
+
+    ws.lanes = lanes;
+    ws.variables.assign(variables.size()*lanes, 0.0);
+    ws.bound.assign(variables.size(), false);
+    ws.changed.assign(variables.size(), true);
+    ws.computed = false;
+    ws.values.assign(programs.empty() ? 0 : programs[0].nodes.size()*lanes, 0.0);
+}
+
+int Evaluator::getIndex(const ex& s) const
+{
+    auto it = variableIndex.find(s);
+    return it==variableIndex.end() ? -1 : it->second;
+}
+
+void Evaluator::setVariable(EvaluatorWorkspace& ws, int i, double value) const
+{
+    if (i<0) return;
+
+    auto first = ws.variables.begin()+i*ws.lanes, last = first+ws.lanes;
+    if (any_of(first, last, [value](double x) { return x!=value; })) ws.changed[i] = true;
+    fill(first, last, value);
+    ws.bound[i] = true;
+}
+
+void Evaluator::setVariable(EvaluatorWorkspace& ws, const ex& s, double value) const
+{
+    setVariable(ws, getIndex(s), value);
+}
+
+void Evaluator::setVariable(EvaluatorWorkspace& ws, const ex& s, const DoubleVector& values) const
+{
+    auto it = variableIndex.find(s);
+    if (it==variableIndex.end()) return;
+
+    if ((int) values.size()!=ws.lanes)
+        throw SEBException("Expected "+to_string(ws.lanes)+" values for "+to_string_ex(s)+" got "+to_string(values.size()),
+                           "Evaluator::setVariable(EvaluatorWorkspace&, ex, DoubleVector&)");
+
+    int i = it->second;
+    auto first = ws.variables.begin()+i*ws.lanes;
+    if (!equal(values.begin(), values.end(), first)) ws.changed[i] = true;
+    copy(values.begin(), values.end(), first);
+    ws.bound[i] = true;
+}
+
+void Evaluator::setVariables(EvaluatorWorkspace& ws, const ParameterList& pl) const
+{
+    for (auto& p : pl)
+      {
+        if (!variableIndex.count(p.first)) continue;
+
+        ex v = p.second.evalf();
+        if (!is_a<numeric>(v) || !ex_to<numeric>(v).is_real())
+            throw SEBException("Parameter "+to_string_ex(p.first)+"="+to_string_ex(p.second)+" is not a real number",
+                               "Evaluator::setVariables(EvaluatorWorkspace&, ParameterList&)");
+
+        setVariable(ws, p.first, ex_to<numeric>(v).to_double());
+      }
+}
+
+
+/*
+    Evaluation
+*/
+
+static double powi(double x, int n)
+{
+    if (n<0) return 1.0/powi(x, -n);
+    double r = 1.0;
+    while (n)
+      {
+        if (n & 1) r *= x;
+        x *= x;
+        n >>= 1;
+      }
+    return r;
+}
+
+void Evaluator::ComputeNode(const EvaluatorProgram& prog, int n, double* values, EvaluatorWorkspace& ws) const
+{
+    const EvaluatorNode& node = prog.nodes[n];
+    const int L = ws.lanes;
+    double* out = values+n*L;
+
+    switch (node.op)
+      {
+        case OPCONSTANT:
+          for (int l=0; l<L; l++) out[l] = node.value;
+          break;
+
+        case OPVARIABLE:
+          copy(ws.variables.begin()+node.index*L, ws.variables.begin()+(node.index+1)*L, out);
+          break;
+
+        case OPADD:
+          {
+            const double* a = values+node.args[0]*L;
+            for (int l=0; l<L; l++) out[l] = a[l];
+            for (size_t i=1; i<node.args.size(); i++)
+              {
+                a = values+node.args[i]*L;
+                for (int l=0; l<L; l++) out[l] += a[l];
+              }
+          }
+          break;
+
+        case OPMUL:
+          {
+            const double* a = values+node.args[0]*L;
+            for (int l=0; l<L; l++) out[l] = a[l];
+            for (size_t i=1; i<node.args.size(); i++)
+              {
+                a = values+node.args[i]*L;
+                for (int l=0; l<L; l++) out[l] *= a[l];
+              }
+          }
+          break;
+
+        case OPPOWINT:
+          {
+            const double* a = values+node.args[0]*L;
+            for (int l=0; l<L; l++) out[l] = powi(a[l], node.index);
+          }
+          break;
+
+        case OPSQRT:
+          {
+            const double* a = values+node.args[0]*L;
+            for (int l=0; l<L; l++) out[l] = sqrt(a[l]);
+          }
+          break;
+
+        case OPPOW:
+          {
+            const double* a = values+node.args[0]*L;
+            const double* b = values+node.args[1]*L;
+            for (int l=0; l<L; l++) out[l] = pow(a[l], b[l]);
+          }
+          break;
+
+        case OPFUNCTION1:
+          {
+            const double* a = values+node.args[0]*L;
+            for (int l=0; l<L; l++) out[l] = node.f1(a[l]);
+          }
+          break;
+
+        case OPFUNCTION2:
+          {
+            const double* a = values+node.args[0]*L;
+            const double* b = values+node.args[1]*L;
+            for (int l=0; l<L; l++) out[l] = node.f2(a[l], b[l]);
+          }
+          break;
+
+        case OPINTEGRAL:
+          ComputeIntegral(node, values, n, ws);
+          break;
+      }
+}
+
+/*
+    Integrals are evaluated by composite Gauss-Legendre quadrature. The number of panels is doubled
+    until two successive estimates agree to within integralTolerance for all lanes.
+    Nodes of the integrand that does not depend on the integration variable are computed only once.
+*/
+void Evaluator::ComputeIntegral(const EvaluatorNode& node, double* values, int n, EvaluatorWorkspace& ws) const
+{
+    const int L = ws.lanes;
+    const EvaluatorProgram& prog = programs[node.program];
+    const GaussLegendreRule& rule = PanelRule();
+    const int v = node.index;
+
+    const double* a = values+node.args[0]*L;
+    const double* b = values+node.args[1]*L;
+    double* out = values+n*L;
+    double* t = &ws.variables[v*L];
+
+    vector<double> sub(prog.nodes.size()*L);
+    vector<int> inner;
+    for (size_t i=0; i<prog.nodes.size(); i++)
+      {
+        if (maskHas(prog.depends[i], v)) inner.push_back(i);
+        else ComputeNode(prog, i, sub.data(), ws);
+      }
+
+    const double* f = sub.data()+prog.output*L;
+    vector<double> current(L), previous(L);
+
+    for (int panels=4; ; panels*=2)
+      {
+        fill(current.begin(), current.end(), 0.0);
+
+        for (int p=0; p<panels; p++)
+          for (size_t i=0; i<rule.x.size(); i++)
+            {
+              for (int l=0; l<L; l++) t[l] = a[l]+(b[l]-a[l])*(p+rule.x[i])/panels;
+              for (int k : inner) ComputeNode(prog, k, sub.data(), ws);
+              for (int l=0; l<L; l++) current[l] += (b[l]-a[l])/panels*rule.w[i]*f[l];
+            }
+
+        if (panels>4)
+          {
+            double scale = 0;
+            for (int l=0; l<L; l++) scale = max(scale, fabs(current[l]));
+
+            bool converged = true;
+            for (int l=0; l<L; l++)
+               if (fabs(current[l]-previous[l]) > integralTolerance*fabs(current[l]) + 1e-14*scale) converged = false;
+
+            if (converged || panels>=integralMaxPanels) break;
+          }
+
+        swap(current, previous);
+      }
+
+    copy(current.begin(), current.end(), out);
+}
+
+vector<int> Evaluator::Schedule(const exset& changed) const
+{
+    vector<uint64_t> mask;
+    for (auto& s : changed)
+      {
+        auto it = variableIndex.find(s);
+        if (it!=variableIndex.end()) maskSet(mask, it->second);
+      }
+
+    return Schedule(mask);
+}
+
+vector<int> Evaluator::Schedule(const vector<uint64_t>& mask) const
+{
+    vector<int> schedule;
+    if (programs.empty()) return schedule;
+
+    for (size_t n=0; n<programs[0].nodes.size(); n++)
+       if (maskIntersects(programs[0].depends[n], mask)) schedule.push_back(n);
+
+    return schedule;
+}
+
+void Evaluator::CheckVariables(const EvaluatorWorkspace& ws) const
+{
+    if (programs.empty()) return;
+
+    if (ws.values.size()!=programs[0].nodes.size()*ws.lanes)
+       throw SEBException("Workspace was not prepared for this evaluator", "Evaluator::CheckVariables(EvaluatorWorkspace&)");
+
+    for (size_t i=0; i<variables.size(); i++)
+       if (!integrationVariable[i] && !ws.bound[i])
+         {
+          GiNaCLock lock;   // Compute may run without the lock, but printing the symbol uses GiNaC.
+          throw SEBException("Expression did not evaluate to number, since "+to_string_ex(variables[i])+" was not specified",
+                             "Evaluator::CheckVariables(EvaluatorWorkspace&)");
+         }
+}
+
+void Evaluator::ComputeAll(EvaluatorWorkspace& ws) const
+{
+    if (programs.empty()) return;
+
+    for (size_t n=0; n<programs[0].nodes.size(); n++)
+       ComputeNode(programs[0], n, ws.values.data(), ws);
+
+    fill(ws.changed.begin(), ws.changed.end(), false);
+    ws.computed = true;
+}
+
+void Evaluator::Compute(EvaluatorWorkspace& ws) const
+{
+    CheckVariables(ws);
+    ComputeAll(ws);
+}
+
+void Evaluator::Compute(EvaluatorWorkspace& ws, const vector<int>& schedule) const
+{
+    for (int n : schedule)
+       ComputeNode(programs[0], n, ws.values.data(), ws);
+}
+
+void Evaluator::Update(EvaluatorWorkspace& ws) const
+{
+    if (!ws.computed) return Compute(ws);
+    CheckVariables(ws);
+
+    vector<uint64_t> mask;
+    for (size_t i=0; i<variables.size(); i++)
+       if (ws.changed[i]) maskSet(mask, i);
+    if (mask.empty()) return;
+
+    Compute(ws, Schedule(mask));
+    fill(ws.changed.begin(), ws.changed.end(), false);
+}
+
+/*
+    Each variable is perturbed in turn, and only the nodes depending on it are recomputed. Their values are
+    saved beforehand and restored afterwards, which is cheaper than recomputing them at the original value.
+*/
+vector<DoubleVector> Evaluator::Jacobian(EvaluatorWorkspace& ws, int k, const vector<int>& indices, double step) const
+try
+{
+    Update(ws);
+
+    const int L = ws.lanes;
+    const int out = outputs.at(k);
+    vector<DoubleVector> columns(indices.size(), DoubleVector(L, 0.0));
+    vector<double> saved, x(L);
+
+    for (size_t c=0; c<indices.size(); c++)
+      {
+        int v = indices[c];
+        if (v<0 || v>=(int) variables.size() || integrationVariable[v]) continue;
+
+        vector<uint64_t> mask;
+        maskSet(mask, v);
+        vector<int> schedule = Schedule(mask);
+        if (schedule.empty()) continue;
+
+        saved.resize(schedule.size()*L);
+        for (size_t i=0; i<schedule.size(); i++)
+           copy(ws.values.begin()+schedule[i]*L, ws.values.begin()+(schedule[i]+1)*L, saved.begin()+i*L);
+
+        double* var = &ws.variables[v*L];
+        copy(var, var+L, x.begin());
+        for (int l=0; l<L; l++) var[l] = x[l] + step*max(fabs(x[l]), 1.0);
+
+        Compute(ws, schedule);
+
+        const double* f  = Output(ws, k);
+        auto it = find(schedule.begin(), schedule.end(), out);
+        const double* f0 = it==schedule.end() ? f : saved.data()+(it-schedule.begin())*L;
+        for (int l=0; l<L; l++) columns[c][l] = (f[l]-f0[l])/(var[l]-x[l]);
+
+        copy(x.begin(), x.end(), var);
+        for (size_t i=0; i<schedule.size(); i++)
+           copy(saved.begin()+i*L, saved.begin()+(i+1)*L, ws.values.begin()+schedule[i]*L);
+      }
+
+    return columns;
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Evaluator::Jacobian(EvaluatorWorkspace&, int, vector<int>&, double)");
+    throw;
+}
+
+const double* Evaluator::Output(const EvaluatorWorkspace& ws, int k) const
+{
+    return ws.values.data()+outputs.at(k)*ws.lanes;
+}
+
+/*
+    The lanes are evaluated in blocks, which keeps the node values of a block in cache, and the blocks are
+    distributed over all cores. Parameters are converted to doubles under the GiNaC lock before ParallelFor, since GiNaC is not thread safe.
+*/
+vector<DoubleVector> Evaluator::Evaluate(const ParameterList& pl, const ex& lanevar, const DoubleVector& lanevalues) const
+{
+    return Evaluate(pl, lanevar, lanevalues, LaneValues());
+}
+
+vector<DoubleVector> Evaluator::Evaluate(const ParameterList& pl, const ex& lanevar, const DoubleVector& lanevalues, const LaneValues& lanevariables) const
+try
+{
+    const int N = lanevalues.size();
+    // At most 256 lanes per block, but small enough that all cores get work.
+    const int block = max(16, min(256, (N+NumberOfThreads()-1)/NumberOfThreads()));
+    vector<DoubleVector> result(NumberOfOutputs(), DoubleVector(N, 0.0));
+    if (N==0) return result;
+
+    // Check all variables are assigned on a single lane workspace.
+    EvaluatorWorkspace check;
+    int lane;
+    vector<pair<int, const DoubleVector*>> lanes;
+      {
+        GiNaCLock lock;
+        Prepare(check, 1);
+        setVariables(check, pl);
+        setVariable(check, lanevar, 0.0);
+        for (auto& v : lanevariables)
+          {
+            int i = getIndex(v.first);
+            if (i<0) continue;
+            if ((int) v.second.size()!=N) throw SEBException("Expected "+to_string(N)+" values for "+to_string_ex(v.first)+" got "+to_string(v.second.size()));
+            setVariable(check, i, 0.0);
+            lanes.push_back( make_pair(i, &v.second) );
+          }
+        CheckVariables(check);
+        lane = getIndex(lanevar);
+      }
+
+    ParallelFor( (N+block-1)/block, [&](int chunk, int begin, int end)
+      {
+        EvaluatorWorkspace ws;
+        for (int b=begin; b<end; b++)
+          {
+            int first = b*block;
+            int n = min(block, N-first);
+            Prepare(ws, n);
+
+            for (size_t i=0; i<variables.size(); i++)
+               if (check.bound[i]) setVariable(ws, (int) i, check.variables[i]);
+
+            if (lane>=0) copy(lanevalues.begin()+first, lanevalues.begin()+first+n, ws.variables.begin()+lane*n);
+            for (auto& v : lanes)
+               copy(v.second->begin()+first, v.second->begin()+first+n, ws.variables.begin()+v.first*n);
+
+            ComputeAll(ws);
+
+            for (int k=0; k<NumberOfOutputs(); k++)
+              {
+                const double* o = Output(ws, k);
+                copy(o, o+n, result[k].begin()+first);
+              }
+          }
+      } );
+
+    return result;
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Evaluator::Evaluate(ParameterList&, ex, DoubleVector&, LaneValues&)");
+    throw;
+}
@@ -0,0 +1,186 @@
+//===========================================================================
+// Included guards
+#ifndef INCLUDE_GUARD_EVALUATOR
+#define INCLUDE_GUARD_EVALUATOR
+
+//===========================================================================
+// included dependencies
+#include <vector>
+#include <map>
+#include <string>
+#include <cstdint>
+
+#include "Types.hpp"
+#include "Exceptions.hpp"
+#include "SymbolInterface.hpp"
+#include "SpecialFunctions.hpp"
+
+//===========================================================================
+// used namespaces
+using namespace std;
+using namespace GiNaC;
+
+/*
+    Evaluator compiles one or more scattering expressions into a program of plain numerical operations,
+    which is then evaluated for many q values (lanes) at once without involving GiNaC.
+
+    Sub-expressions that occur several times (e.g. the same sub-unit form factor amplitude in many terms)
+    are compiled into a single node, and every node records which symbols it depends on. Hence when only
+    a few parameters change between evaluations only the nodes depending on these need to be recomputed.
+    This is used by the polydispersity average, where everything that does not depend on the polydisperse
+    parameters is computed only once.
+
+    The workspace also remembers which variables were assigned new values since it was last computed, so in
+    a fitting loop Update(ws) recomputes only the terms depending on the parameters that actually changed,
+    e.g. only the Rg_B terms of a diblock. Jacobian() uses the same mechanism to compute the derivatives
+    with respect to each parameter by recomputing only the nodes that depend on it.
+
+    Integrals, e.g. the orientational averages of SolidCylinder and ThinDisk, are compiled into a separate
+    program evaluated by composite Gauss-Legendre quadrature, where the number of panels is doubled until
+    the result has converged.
+
+    Usage:
+
+         Evaluator ev( {F, A} );                     // compile expressions
+         EvaluatorWorkspace ws;
+         ev.Prepare(ws, qvec.size());                // one lane per q value
+         ev.setVariables(ws, params);                // bind parameters
+         ev.setVariable(ws, q, qvec);                // bind q lane values
+         ev.Compute(ws);
+         const double* Fq = ev.Output(ws, 0);        // F(q) for each lane
+
+         ev.setVariable(ws, Rg, 2.0);                // change a parameter
+         ev.Update(ws);                              // recompute only the terms depending on Rg
+
+    The compiled program is never changed by evaluation, hence the same Evaluator can be used from
+    several threads, as long as each thread uses its own EvaluatorWorkspace.
+*/
+
+// Numerical operations of evaluator nodes.
+enum evaluatorops{ OPCONSTANT, OPVARIABLE, OPADD, OPMUL, OPPOWINT, OPSQRT, OPPOW, OPFUNCTION1, OPFUNCTION2, OPINTEGRAL };
+
+// Values of variables that differ between lanes, e.g. numerically evaluated inner structure terms.
+typedef map<ex, DoubleVector, ex_is_less> LaneValues;
+
+struct EvaluatorNode
+{
+    int op;                                   // One of evaluatorops.
+    vector<int> args;                         // Argument nodes (in the same program).
+    double value = 0;                         // OPCONSTANT: value.
+    int index = -1;                           // OPVARIABLE, OPINTEGRAL: variable index, OPPOWINT: exponent.
+    int program = -1;                         // OPINTEGRAL: program computing the integrand.
+    double (*f1)(double) = nullptr;           // OPFUNCTION1
+    double (*f2)(double, double) = nullptr;   // OPFUNCTION2
+};
+
+struct EvaluatorProgram
+{
+    vector<EvaluatorNode> nodes;              // Nodes in evaluation order, arguments always precede the node using them.
+    vector<vector<uint64_t>> depends;         // Bit mask of the variables each node depends on.
+    map<ex, int, ex_is_less> memo;            // Expression -> node, used to share identical sub-expressions.
+    int output = -1;                          // Integrand node for integral programs.
+};
+
+/*
+   Workspace holding variable and node values for one evaluation. Copying a prepared workspace
+   is the way to give each thread its own workspace.
+*/
+struct EvaluatorWorkspace
+{
+    int lanes = 0;
+    vector<double> variables;                 // lanes values for each variable.
+    vector<char> bound;                       // Has the variable been assigned?
+    vector<char> changed;                     // Has the variable changed since node values were computed?
+    bool computed = false;                    // Are the node values computed?
+    vector<double> values;                    // lanes values for each node of the main program.
+};
+
+class Evaluator
+{
+private:
+
+    // programs[0] is the main program, the rest are integrands.
+    vector<EvaluatorProgram> programs;
+
+    // outputs of the main program.
+    vector<int> outputs;
+
+    // variable symbols and their indices.
+    vector<ex> variables;
+    map<ex, int, ex_is_less> variableIndex;
+    vector<char> integrationVariable;
+
+    // Relative tolerance and maximal number of panels used for integrals.
+    double integralTolerance = 1e-8;
+    int integralMaxPanels = 512;
+
+    int getVariable(const ex& s);
+    int addNode(int p, const ex& e, EvaluatorNode& node, vector<uint64_t>& mask);
+    int CompileNode(const ex& e, int p);
+
+    // Throws if a variable has not been assigned.
+    void CheckVariables(const EvaluatorWorkspace& ws) const;
+    void ComputeAll(EvaluatorWorkspace& ws) const;
+    vector<int> Schedule(const vector<uint64_t>& mask) const;
+
+    void ComputeNode(const EvaluatorProgram& prog, int n, double* values, EvaluatorWorkspace& ws) const;
+    void ComputeIntegral(const EvaluatorNode& node, double* values, int n, EvaluatorWorkspace& ws) const;
+
+public:
+
+    Evaluator() {};
+    Evaluator(const ex& e) { Compile(e); };
+    Evaluator(const vector<ex>& e) { for (auto& x : e) Compile(x); };
+
+    // Compile an expression and add it as the next output. Returns output index.
+    int Compile(const ex& e);
+
+    // Size of compiled program.
+    int NumberOfOutputs()  const { return outputs.size(); }
+    int NumberOfNodes()    const;
+
+    // Set of free symbols that must be assigned before evaluation.
+    exset Symbols() const;
+
+    // Does output k depend on symbol s?
+    bool DependsOn(int k, const ex& s) const;
+
+    // Allocate a workspace for evaluation of lanes values at a time.
+    void Prepare(EvaluatorWorkspace& ws, int lanes) const;
+
+    // Index of the variable s, or -1 if s is not used by the program.
+    int getIndex(const ex& s) const;
+
+    // Assign values to variables. Symbols not used by the program are silently ignored.
+    // Assignment by index does not touch any GiNaC objects, and is safe to use inside ParallelFor.
+    void setVariable(EvaluatorWorkspace& ws, int index, double value) const;
+    void setVariable(EvaluatorWorkspace& ws, const ex& s, double value) const;
+    void setVariable(EvaluatorWorkspace& ws, const ex& s, const DoubleVector& values) const;
+    void setVariables(EvaluatorWorkspace& ws, const ParameterList& pl) const;
+
+    // Nodes of the main program that has to be recomputed when the given symbols change.
+    vector<int> Schedule(const exset& changed) const;
+
+    // Compute all nodes, or only the nodes on a schedule.
+    void Compute(EvaluatorWorkspace& ws) const;
+    void Compute(EvaluatorWorkspace& ws, const vector<int>& schedule) const;
+
+    // Recompute only the nodes depending on variables that changed since the workspace was last computed.
+    void Update(EvaluatorWorkspace& ws) const;
+
+    // Derivatives of output k with respect to the variables with the given indices, by forward differences
+    // with relative step size. Only nodes depending on each variable are recomputed, and the workspace is
+    // left with the values at the unperturbed variables. Column i holds the lanes derivatives wrt. indices[i].
+    vector<DoubleVector> Jacobian(EvaluatorWorkspace& ws, int k, const vector<int>& indices, double step=1e-6) const;
+
+    // Pointer to the ws.lanes values of output k.
+    const double* Output(const EvaluatorWorkspace& ws, int k) const;
+
+    // Evaluate all outputs at the given values of a lane variable (typically q), using all cores.
+    vector<DoubleVector> Evaluate(const ParameterList& pl, const ex& lanevar, const DoubleVector& lanevalues) const;
+
+    // Same, where some further variables also have a value for each lane.
+    vector<DoubleVector> Evaluate(const ParameterList& pl, const ex& lanevar, const DoubleVector& lanevalues, const LaneValues& lanevariables) const;
+};
+
+#endif // INCLUDE_GUARD_EVALUATOR
@@ -0,0 +1,99 @@
+/*
+    Weighted mixtures of structures. See Mixture.hpp.
+*/
+
+#include "Mixture.hpp"
+
+// The q symbol of the global symbol table, the result is constructed before the lock is released.
+static ex GlobalQSymbol()
+{
+    GiNaCLock lock;
+    return SymbolInterface::instance()->getSymbol("q");
+}
+
+Mixture::Mixture() : qsymbol(GlobalQSymbol())
+{
+}
+
+void Mixture::Add(double weight, const ex& I)
+{
+    if (weight<0) throw SEBException("Negative weight "+to_string(weight)+" of mixture member", "Mixture::Add(double, ex)");
+
+    weights.push_back(weight);
+    members.push_back(I);
+    compiled = false;
+}
+
+void Mixture::Add(double weight, World& w, string name, int varForm)
+try
+{
+    ex q = w.GetSymbolInterface()->getSymbol("q");
+    if (qFromWorld && !q.is_equal(qsymbol)) throw SEBException("Members from worlds with different symbol tables can not be mixed");
+    qsymbol = q;
+    qFromWorld = true;
+
+    Add(weight, w.FormFactor_Unnormalized(name, WORLDMAXDEPTH, varForm));     // World caches the derived terms of its structures.
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Mixture::Add(double, World&, "+name+", "+to_string(varForm)+")");
+    throw;
+}
+
+void Mixture::Add(const DoubleVector& w, const std::function<ex(int)>& generate)
+try
+{
+    for (int k=0; k<(int) w.size(); k++)
+        Add(w[k], generate(k));
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Mixture::Add(DoubleVector&, function)");
+    throw;
+}
+
+void Mixture::Compile()
+{
+    if (compiled) return;
+
+    ev = Evaluator(members);
+    compiled = true;
+}
+
+DoubleVector Mixture::Evaluate(ParameterList& pl, DoubleVector& q)
+try
+{
+    Compile();
+    vector<DoubleVector> I = ev.Evaluate(pl, qsymbol, q);
+
+    DoubleVector total(q.size(), 0.0);
+    for (size_t k=0; k<I.size(); k++)
+       for (size_t i=0; i<q.size(); i++)
+          total[i] += weights[k]*I[k][i];
+
+    return total;
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Mixture::Evaluate(ParameterList&, DoubleVector&)");
+    throw;
+}
+
+DoubleVector Mixture::Evaluate(ParameterList& pl, DoubleVector& q, Polydispersity& pd)
+try
+{
+    Compile();
+    vector<DoubleVector> I = pd.Average(ev, pl, qsymbol, q);
+
+    DoubleVector total(q.size(), 0.0);
+    for (size_t k=0; k<I.size(); k++)
+       for (size_t i=0; i<q.size(); i++)
+          total[i] += weights[k]*I[k][i];
+
+    return total;
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Mixture::Evaluate(ParameterList&, DoubleVector&, Polydispersity&)");
+    throw;
+}
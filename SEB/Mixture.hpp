@@ -0,0 +1,74 @@
+//===========================================================================
+// Included guards
+#ifndef INCLUDE_GUARD_MIXTURE
+#define INCLUDE_GUARD_MIXTURE
+
+//===========================================================================
+// included dependencies
+#include <vector>
+#include <map>
+#include <functional>
+
+#include "World.hpp"
+
+//===========================================================================
+// used namespaces
+using namespace std;
+using namespace GiNaC;
+
+/*
+    Mixture describes a population of different structures, e.g. micelles with a distribution of aggregation
+    numbers, or an ensemble of random branched topologies. The total intensity is the weighted sum
+
+        I(q) = sum_k w_k I_k(q)
+
+    where I_k is the unnormalized form factor of member k (or any expression supplied by the user).
+
+    Adding the same structure of a World again does not derive it again, since the World caches the terms it
+    has derived, and keeps them up to date as structures grow. All members are compiled into one Evaluator, hence sub-unit terms that are shared
+    between members (e.g. identical polymers in micelles with different aggregation numbers) are only
+    evaluated once, and the fused program is evaluated on all cores.
+*/
+
+class Mixture
+{
+private:
+
+    vector<double> weights;
+    vector<ex> members;
+
+    // The q symbol, taken from the worlds of the members since worlds may have private symbol tables.
+    // Until a member is added from a world, that of the global symbol table.
+    ex qsymbol;
+    bool qFromWorld = false;
+
+    // Compiled members, recompiled when members are added.
+    Evaluator ev;
+    bool compiled = false;
+
+    void Compile();
+
+public:
+
+    // The q symbol of the global symbol table is copied under the GiNaC lock, so mixtures can be created on any thread.
+    Mixture();
+
+    // Add member with an expression for its intensity.
+    void Add(double weight, const ex& I);
+
+    // Add member as the unnormalized form factor of structure name in world w.
+    void Add(double weight, World& w, string name, int varForm = QVAR);
+
+    // Add a family of members, member k has intensity generate(k) and weight weights[k].
+    void Add(const DoubleVector& weights, const std::function<ex(int)>& generate);
+
+    int NumberOfMembers() const { return members.size(); }
+    const ex& getMember(int k) const { return members.at(k); }
+    double getWeight(int k) const { return weights.at(k); }
+
+    // Weighted total intensity, optionally averaged over polydisperse parameters.
+    DoubleVector Evaluate(ParameterList& pl, DoubleVector& q);
+    DoubleVector Evaluate(ParameterList& pl, DoubleVector& q, Polydispersity& pd);
+};
+
+#endif // INCLUDE_GUARD_MIXTURE
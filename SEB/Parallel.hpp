@@ -0,0 +1,94 @@
+//===========================================================================
+// Included guards
+#ifndef INCLUDE_GUARD_PARALLEL
+#define INCLUDE_GUARD_PARALLEL
+
+//===========================================================================
+// included dependencies
+#include <thread>
+#include <vector>
+#include <functional>
+#include <exception>
+#include <atomic>
+
+using namespace std;
+
+/*
+    Minimal helpers for running independent numerical work on all available cores.
+
+    ParallelFor splits the range [0:n) into contiguous chunks, and calls body(chunk, begin, end)
+    once for each chunk on a separate thread. Chunks are numbered 0..chunks-1 so callers can
+    store per chunk partial results and reduce them afterwards in a fixed order.
+
+    Exceptions thrown inside a chunk are caught and rethrown in the calling thread.
+
+    NB. GiNaC is not thread safe, hence body must not create, copy or destroy GiNaC expressions (see GiNaCLock in SymbolInterface.hpp).
+*/
+
+// Number of threads SEB uses for parallel work.
+inline int NumberOfThreads()
+{
+    unsigned n = thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// Runs body(chunk, begin, end) on contiguous chunks of [0:n). Returns the number of chunks used.
+inline int ParallelFor(int n, const std::function<void(int, int, int)>& body, int threads = NumberOfThreads())
+{
+    if (n <= 0) return 0;
+    if (threads > n) threads = n;
+    if (threads <= 1)
+      {
+         body(0, 0, n);
+         return 1;
+      }
+
+    vector<exception_ptr> errors(threads);
+    vector<thread> workers;
+    for (int c = 0; c < threads; c++)
+      {
+         int begin = (long)n*c/threads;
+         int end   = (long)n*(c+1)/threads;
+         workers.push_back( thread( [&body, &errors, c, begin, end]()
+                                    {
+                                       try { body(c, begin, end); }
+                                       catch (...) { errors[c] = current_exception(); }
+                                    } ) );
+      }
+
+    for (auto& w : workers) w.join();
+    for (auto& e : errors) if (e) rethrow_exception(e);
+
+    return threads;
+}
+
+/*
+   Runs body(task) for tasks 0..n-1. Rather than fixed chunks, every thread takes the next unstarted task
+   when it is done with the previous one, hence tasks of very different cost are balanced over the threads.
+   Callers should store results per task, and combine them afterwards in task order.
+*/
+inline void ParallelTasks(int n, const std::function<void(int)>& body, int threads = NumberOfThreads())
+{
+    if (n <= 0) return;
+    if (threads > n) threads = n;
+    if (threads <= 1)
+      {
+         for (int t = 0; t < n; t++) body(t);
+         return;
+      }
+
+    atomic<int> next(0);
+    vector<exception_ptr> errors(threads);
+    vector<thread> workers;
+    for (int c = 0; c < threads; c++)
+         workers.push_back( thread( [&body, &errors, &next, n, c]()
+                                    {
+                                       try { for (int t = next++; t < n; t = next++) body(t); }
+                                       catch (...) { errors[c] = current_exception(); next = n; }
+                                    } ) );
+
+    for (auto& w : workers) w.join();
+    for (auto& e : errors) if (e) rethrow_exception(e);
+}
+
+#endif // INCLUDE_GUARD_PARALLEL
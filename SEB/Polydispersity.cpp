@@ -0,0 +1,199 @@
+/*
+    Averaging of compiled scattering expressions over polydisperse parameters.
+    See Polydispersity.hpp for the supported distributions.
+*/
+
+#include "Polydispersity.hpp"
+#include "Parallel.hpp"
+
+#include <cmath>
+#include <sstream>
+#include <gsl/gsl_integration.h>
+
+
+void Polydispersity::Add(const ex& parameter, int family, double width, int nodes)
+{
+    if (!is_a<symbol>(parameter))                             throw SEBException("Only symbols can be polydisperse", "Polydispersity::Add(ex, int, double, int)");
+    if (family!=SCHULZ && family!=LOGNORMAL && family!=GAUSSIAN) throw SEBException("Unknown distribution "+to_string(family), "Polydispersity::Add(ex, int, double, int)");
+    if (width<0)                                               throw SEBException("Width can not be negative", "Polydispersity::Add(ex, int, double, int)");
+    if (family==SCHULZ && width>=1)                            throw SEBException("Schulz distribution requires width<1", "Polydispersity::Add(ex, int, double, int)");
+    if (nodes<1)                                               throw SEBException("At least one quadrature node is required", "Polydispersity::Add(ex, int, double, int)");
+
+    for (auto& e : entries)
+      if (e.parameter.is_equal(parameter))
+        {
+          e.family = family;
+          e.width  = width;
+          e.nodes  = nodes;
+          return;
+        }
+
+    entries.push_back( PolydisperseParameter{parameter, family, width, nodes} );
+}
+
+exset Polydispersity::Parameters() const
+{
+    exset s;
+    for (auto& e : entries) s.insert(e.parameter);
+    return s;
+}
+
+/*
+    Gauss quadrature rules for the distributions. Nodes are returned as parameter values, and the
+    weights are normalized to sum to one, such that <f> = sum_i w_i f(x_i).
+*/
+void Polydispersity::Quadrature(int family, double mean, double width, int nodes, DoubleVector& x, DoubleVector& w)
+{
+    x.clear();
+    w.clear();
+
+    if (width==0 || nodes==1)
+      {
+        x.push_back(mean);
+        w.push_back(1.0);
+        return;
+      }
+
+    if (family!=GAUSSIAN && mean<=0)
+        throw SEBException("Mean must be positive for Schulz and log-normal distributions", "Polydispersity::Quadrature(...)");
+
+    gsl_integration_fixed_workspace* ws = nullptr;
+
+    if (family==SCHULZ)
+      {
+        // Weight x^z exp(-b x). Choosing b^(z+1) = Gamma(z+1) keeps GSL's zeroth moment finite for narrow distributions.
+        double z = 1.0/(width*width)-1.0;
+        double b = exp( lgamma(z+1)/(z+1) );
+        ws = gsl_integration_fixed_alloc(gsl_integration_fixed_laguerre, nodes, 0.0, b, z, 0.0);
+        double* xi = gsl_integration_fixed_nodes(ws);
+        double* wi = gsl_integration_fixed_weights(ws);
+        for (int i=0; i<nodes; i++)
+          {
+            x.push_back( xi[i]*b*mean/(z+1) );
+            w.push_back( wi[i] );
+          }
+      }
+    else if (family==LOGNORMAL || family==GAUSSIAN)
+      {
+        // Weight exp(-x^2)
+        ws = gsl_integration_fixed_alloc(gsl_integration_fixed_hermite, nodes, 0.0, 1.0, 0.0, 0.0);
+        double* xi = gsl_integration_fixed_nodes(ws);
+        double* wi = gsl_integration_fixed_weights(ws);
+
+        // Log-normal: ln p has standard deviation sl and mean mu, such that <p>=mean.
+        double sl = sqrt( log(1+width*width) );
+        double mu = family==LOGNORMAL ? log(mean)-sl*sl/2 : 0.0;
+        for (int i=0; i<nodes; i++)
+          {
+            double p = family==LOGNORMAL ? exp(mu+sqrt(2.0)*sl*xi[i]) : mean*(1+width*sqrt(2.0)*xi[i]);
+            if (p<=0) continue;
+            x.push_back( p );
+            w.push_back( wi[i] );
+          }
+      }
+    else
+        throw SEBException("Unknown distribution "+to_string(family), "Polydispersity::Quadrature(...)");
+
+    gsl_integration_fixed_free(ws);
+
+    double sum = 0;
+    for (auto v : w) sum += v;
+    if (x.empty() || !(sum>0)) throw SEBException("Could not generate quadrature for distribution", "Polydispersity::Quadrature(...)");
+    for (auto& v : w) v /= sum;
+}
+
+
+vector<DoubleVector> Polydispersity::Average(const Evaluator& ev, const ParameterList& pl, const ex& lanevar, const DoubleVector& lanevalues) const
+try
+{
+    // Quadrature rules for the polydisperse parameters the expression actually depends on.
+    GiNaCLock lock;
+    vector<int> index;
+    vector<DoubleVector> x, w;
+    exset active;
+
+    for (auto& p : entries)
+      {
+        int i = ev.getIndex(p.parameter);
+        if (i<0) continue;
+
+        auto it = pl.find(p.parameter);
+        ex mean = it==pl.end() ? ex(p.parameter) : it->second.evalf();
+        if (!is_a<numeric>(mean))
+          {
+            ostringstream os;
+            os << p.parameter;
+            throw SEBException("Polydisperse parameter "+os.str()+" has not been assigned a mean value");
+          }
+
+        DoubleVector xi, wi;
+        Quadrature(p.family, ex_to<numeric>(mean).to_double(), p.width, p.nodes, xi, wi);
+
+        index.push_back(i);
+        x.push_back(xi);
+        w.push_back(wi);
+        active.insert(p.parameter);
+      }
+
+    // Compute everything once at the mean values, then only the nodes depending on the polydisperse parameters are recomputed.
+    EvaluatorWorkspace ws;
+    ev.Prepare(ws, lanevalues.size());
+    ev.setVariables(ws, pl);
+    ev.setVariable(ws, lanevar, lanevalues);
+    ev.Compute(ws);
+
+    vector<int> schedule = ev.Schedule(active);
+    active.clear();
+    lock.unlock();
+
+    const int L = ws.lanes;
+    const int outputs = ev.NumberOfOutputs();
+
+    int total = 1;
+    for (auto& xi : x) total *= xi.size();
+
+    int threads = NumberOfThreads();
+    vector<DoubleVector> partial(threads, DoubleVector(outputs*L, 0.0));
+
+    ParallelFor(total, [&](int chunk, int begin, int end)
+      {
+        EvaluatorWorkspace local(ws);
+        DoubleVector& sum = partial[chunk];
+
+        for (int k=begin; k<end; k++)
+          {
+            // Decompose k into a node index for each parameter
+            double weight = 1.0;
+            int r = k;
+            for (size_t j=0; j<x.size(); j++)
+              {
+                int m = r % x[j].size();
+                r /= x[j].size();
+                ev.setVariable(local, index[j], x[j][m]);
+                weight *= w[j][m];
+              }
+
+            ev.Compute(local, schedule);
+
+            for (int o=0; o<outputs; o++)
+              {
+                const double* v = ev.Output(local, o);
+                for (int l=0; l<L; l++) sum[o*L+l] += weight*v[l];
+              }
+          }
+      }, threads);
+
+    // Reduce in chunk order, so results do not depend on thread timing.
+    vector<DoubleVector> result(outputs, DoubleVector(L, 0.0));
+    for (auto& sum : partial)
+      for (int o=0; o<outputs; o++)
+        for (int l=0; l<L; l++)
+          result[o][l] += sum[o*L+l];
+
+    return result;
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Polydispersity::Average(Evaluator&, ParameterList&, ex, DoubleVector&)");
+    throw;
+}
@@ -0,0 +1,73 @@
+//===========================================================================
+// Included guards
+#ifndef INCLUDE_GUARD_POLYDISPERSITY
+#define INCLUDE_GUARD_POLYDISPERSITY
+
+//===========================================================================
+// included dependencies
+#include <vector>
+
+#include "Types.hpp"
+#include "Constants.hpp"
+#include "Exceptions.hpp"
+#include "Evaluator.hpp"
+
+//===========================================================================
+// used namespaces
+using namespace std;
+using namespace GiNaC;
+
+/*
+    Polydispersity describes which structural parameters are polydisperse, and averages
+    compiled scattering expressions over their distributions by Gaussian quadrature.
+
+    Each polydisperse parameter is given a distribution family (see distributions in Constants.hpp),
+    a relative width  sigma/<p>  and a number of quadrature nodes. The mean <p> is the value of the
+    parameter in the ParameterList used for evaluation. When several parameters are polydisperse
+    they are assumed to be independent, and a tensor product of the quadrature rules is used.
+
+        SCHULZ     P(p) ~ p^z exp(-(z+1)p/<p>)  with z=1/width^2-1,   Gauss-Laguerre nodes (width<1).
+        LOGNORMAL  ln p is normal distributed with mean <p> and relative standard deviation width, Gauss-Hermite nodes.
+        GAUSSIAN   p is normal distributed with mean <p> and standard deviation width*<p>, Gauss-Hermite nodes.
+                   Nodes with p<=0 are discarded and the weights renormalized.
+
+    During averaging all nodes that does not depend on polydisperse parameters are computed only once,
+    and the quadrature nodes are distributed over all available cores.
+*/
+
+struct PolydisperseParameter
+{
+    ex parameter;
+    int family;
+    double width;
+    int nodes;
+};
+
+class Polydispersity
+{
+private:
+
+    vector<PolydisperseParameter> entries;
+
+public:
+
+    // Declare parameter polydisperse. Redeclaring a parameter replaces its distribution.
+    void Add(const ex& parameter, int family, double width, int nodes = 20);
+
+    // Remove all polydisperse parameters
+    void Clear() { entries.clear(); }
+
+    // Polydisperse parameters
+    exset Parameters() const;
+    const vector<PolydisperseParameter>& getEntries() const { return entries; }
+
+    // Quadrature nodes x and normalized weights w for a distribution with the given mean and relative width.
+    static void Quadrature(int family, double mean, double width, int nodes, DoubleVector& x, DoubleVector& w);
+
+    /* Average all outputs of a compiled expression over the polydisperse parameters.
+       Mean values and all other parameters are taken from pl, and lanevar (typically q) is assigned lanevalues.
+       Returns averages[output][lane]. */
+    vector<DoubleVector> Average(const Evaluator& ev, const ParameterList& pl, const ex& lanevar, const DoubleVector& lanevalues) const;
+};
+
+#endif // INCLUDE_GUARD_POLYDISPERSITY
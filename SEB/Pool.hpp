@@ -0,0 +1,86 @@
+//===========================================================================
+// Included guards
+#ifndef INCLUDE_GUARD_POOL
+#define INCLUDE_GUARD_POOL
+
+//===========================================================================
+// included dependencies
+#include <vector>
+#include <map>
+#include <memory>
+#include <new>
+#include <utility>
+#include <typeindex>
+
+using namespace std;
+
+/*
+    Pool owns objects of many different types. Objects of the same type are constructed next to each
+    other in chunks of contiguous memory, rather than by individual calls to new, and they keep their
+    address for the lifetime of the pool.
+
+    All objects are destroyed together by Clear() or when the pool is destroyed, and memory is released
+    a chunk at a time. Objects can not be released individually.
+*/
+
+class Pool
+{
+private:
+
+    struct ChunksBase
+    {
+        virtual ~ChunksBase() {}
+    };
+
+    template<class T>
+    struct Chunks : ChunksBase
+    {
+        static const int chunksize = 256;
+
+        vector<T*> chunks;
+        int used = chunksize;     // Objects constructed in the last chunk.
+
+        template<class... Args>
+        T* Create(Args&&... args)
+        {
+            if (used == chunksize)
+              {
+                chunks.push_back( static_cast<T*>( ::operator new(chunksize*sizeof(T)) ) );
+                used = 0;
+              }
+
+            T* p = new (chunks.back()+used) T(std::forward<Args>(args)...);
+            used++;
+            return p;
+        }
+
+        ~Chunks()
+        {
+            for (size_t c = 0; c < chunks.size(); c++)
+              {
+                int n = c+1 == chunks.size() ? used : chunksize;
+                for (int i = 0; i < n; i++) chunks[c][i].~T();
+                ::operator delete(chunks[c]);
+              }
+        }
+    };
+
+    map<type_index, unique_ptr<ChunksBase>> types;
+
+public:
+
+    // Constructs an object of type T owned by the pool.
+    template<class T, class... Args>
+    T* Create(Args&&... args)
+    {
+        unique_ptr<ChunksBase>& c = types[ type_index(typeid(T)) ];
+        if (!c) c.reset(new Chunks<T>());
+
+        return static_cast<Chunks<T>*>(c.get())->Create(std::forward<Args>(args)...);
+    }
+
+    // Destroys all objects in the pool.
+    void Clear() { types.clear(); }
+};
+
+#endif // INCLUDE_GUARD_POOL
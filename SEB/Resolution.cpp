@@ -0,0 +1,114 @@
+/*
+    Instrumental resolution smearing of model intensities.
+    See Resolution.hpp for the smearing models.
+*/
+
+#include "Resolution.hpp"
+
+#include <cmath>
+#include <gsl/gsl_integration.h>
+
+
+void Resolution::setTolerance(double tol, int minnodes, int maxnodes)
+{
+    if (tol<=0)                            throw SEBException("Tolerance must be positive", "Resolution::setTolerance(...)");
+    if (minnodes<1 || maxnodes<minnodes)   throw SEBException("Bad range of quadrature nodes", "Resolution::setTolerance(...)");
+
+    tolerance = tol;
+    minNodes  = minnodes;
+    maxNodes  = maxnodes;
+}
+
+void Resolution::Nodes(int i, double q, int n, const DoubleVector& x, const DoubleVector& w, DoubleVector& qn, DoubleVector& wn) const
+{
+    qn.clear();
+    wn.clear();
+
+    double width = mode==PINHOLE ? (dq.empty() ? relative*q : dq[i]) : slit;
+    if (mode==NONE || width<=0)
+      {
+        qn.push_back(q);
+        wn.push_back(1.0);
+        return;
+      }
+
+    double sum = 0;
+    for (int k=0; k<n; k++)
+      {
+        double qk = mode==PINHOLE ? q+sqrt(2.0)*width*x[k] : sqrt( q*q+pow(width*x[k], 2) );
+        if (qk<=0) continue;
+        qn.push_back(qk);
+        wn.push_back(w[k]);
+        sum += w[k];
+      }
+
+    if (qn.empty()) throw SEBException("No resolution nodes at positive q for q="+to_string(q), "Resolution::Nodes(...)");
+    for (auto& v : wn) v /= sum;
+}
+
+DoubleVector Resolution::Smear(const std::function<DoubleVector(const DoubleVector&)>& I, const DoubleVector& q) const
+try
+{
+    if (mode==PINHOLE && !dq.empty() && dq.size()!=q.size())
+        throw SEBException("Number of resolution widths ("+to_string(dq.size())+") does not match number of q values ("+to_string(q.size())+")");
+
+    DoubleVector result(q.size(), 0.0);
+
+    vector<int> active;
+    for (int i=0; i<(int) q.size(); i++) active.push_back(i);
+
+    for (int n=minNodes; !active.empty(); n*=2)
+      {
+        // Base rule: Gauss-Hermite weight exp(-x^2) for pinhole, Gauss-Legendre on [0:1] for slits.
+        DoubleVector x(n), w(n);
+        if (mode==PINHOLE)
+          {
+            gsl_integration_fixed_workspace* t = gsl_integration_fixed_alloc(gsl_integration_fixed_hermite, n, 0.0, 1.0, 0.0, 0.0);
+            for (int k=0; k<n; k++) { x[k]=gsl_integration_fixed_nodes(t)[k]; w[k]=gsl_integration_fixed_weights(t)[k]; }
+            gsl_integration_fixed_free(t);
+          }
+        else if (mode==SLIT)
+          {
+            gsl_integration_glfixed_table* t = gsl_integration_glfixed_table_alloc(n);
+            for (int k=0; k<n; k++) gsl_integration_glfixed_point(0.0, 1.0, k, &x[k], &w[k], t);
+            gsl_integration_glfixed_table_free(t);
+          }
+
+        // Collect nodes of all unconverged points into one batch.
+        DoubleVector batch;
+        vector<DoubleVector> weights(active.size());
+        for (size_t a=0; a<active.size(); a++)
+          {
+            DoubleVector qn;
+            Nodes(active[a], q[active[a]], n, x, w, qn, weights[a]);
+            batch.insert(batch.end(), qn.begin(), qn.end());
+          }
+
+        DoubleVector Ib = I(batch);
+        if (Ib.size()!=batch.size()) throw SEBException("Model returned wrong number of values");
+
+        // Integrate and test convergence
+        vector<int> next;
+        size_t offset = 0;
+        for (size_t a=0; a<active.size(); a++)
+          {
+            int i = active[a];
+            double Is = 0;
+            for (size_t k=0; k<weights[a].size(); k++) Is += weights[a][k]*Ib[offset+k];
+            offset += weights[a].size();
+
+            bool converged = weights[a].size()==1 || (n>minNodes && fabs(Is-result[i]) <= tolerance*fabs(Is));
+            result[i] = Is;
+            if (!converged && 2*n<=maxNodes) next.push_back(i);
+          }
+
+        active = next;
+      }
+
+    return result;
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Resolution::Smear(...)");
+    throw;
+}
@@ -0,0 +1,69 @@
+//===========================================================================
+// Included guards
+#ifndef INCLUDE_GUARD_RESOLUTION
+#define INCLUDE_GUARD_RESOLUTION
+
+//===========================================================================
+// included dependencies
+#include <vector>
+#include <functional>
+
+#include "Types.hpp"
+#include "Exceptions.hpp"
+
+//===========================================================================
+// used namespaces
+using namespace std;
+
+/*
+    Resolution describes the instrumental smearing of a measured intensity, and smears
+    model intensities such that they can be compared directly to data.
+
+       Pinhole:  I_s(q) = \int dq' N(q'; q, dq) I(q')          Gaussian resolution with q dependent width dq,
+                                                                 given either per q point or relative to q.
+                 Nodes with q'<=0 are discarded and the weights renormalized.
+
+       Slit:     I_s(q) = 1/L \int_0 ^L du I(sqrt(q^2+u^2))    Infinitely long slit of length L (in q units).
+
+    The smearing integrals are evaluated by Gauss-Hermite (pinhole) or Gauss-Legendre (slit) quadrature.
+    The number of nodes is doubled for the q points that has not converged to the requested relative
+    tolerance. All nodes in one round are evaluated by a single call to the model, hence the model is
+    evaluated for one large batch of q values, rather than for one q value at a time.
+*/
+
+class Resolution
+{
+private:
+
+    enum { NONE, PINHOLE, SLIT } mode = NONE;
+
+    DoubleVector dq;           // Pinhole width per q point, or
+    double relative = 0;       // pinhole width relative to q if dq is empty.
+    double slit = 0;           // Slit length
+
+    double tolerance = 1e-4;
+    int minNodes = 8;
+    int maxNodes = 128;
+
+    // Quadrature nodes and normalized weights for smearing point q with index i.
+    void Nodes(int i, double q, int n, const DoubleVector& x, const DoubleVector& w, DoubleVector& qn, DoubleVector& wn) const;
+
+public:
+
+    // Gaussian pinhole smearing with a standard deviation for each q point.
+    void setPinhole(const DoubleVector& sigma) { mode=PINHOLE; dq=sigma; relative=0; }
+
+    // Gaussian pinhole smearing with standard deviation sigma=fraction*q
+    void setPinhole(double fraction) { mode=PINHOLE; dq.clear(); relative=fraction; }
+
+    // Slit smearing with a slit of the given length.
+    void setSlit(double length) { mode=SLIT; slit=length; }
+
+    // Relative tolerance and the range of quadrature nodes used for each point.
+    void setTolerance(double tol, int minnodes = 8, int maxnodes = 128);
+
+    // Smear the model I at the q values. I is called with a batch of q values and should return the model intensities at these.
+    DoubleVector Smear(const std::function<DoubleVector(const DoubleVector&)>& I, const DoubleVector& q) const;
+};
+
+#endif // INCLUDE_GUARD_RESOLUTION
@@ -5,5 +5,8 @@
 #define INCLUDE_GUARD_SEB
 
 #include "World.hpp"
+#include "Mixture.hpp"
+#include "Parallel.hpp"
+#include "Simulator.hpp"
 
 #endif
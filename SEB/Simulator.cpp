@@ -0,0 +1,524 @@
+/*
+    Monte Carlo simulation of explicit conformations of structures. See Simulator.hpp.
+*/
+
+#include <algorithm>
+#include <numeric>
+#include <queue>
+
+#include "Simulator.hpp"
+
+
+// Vector helpers and random points, all in the frame of the sub-unit being generated.
+namespace {
+
+typedef array<double, 3> Vec;
+
+inline Vec operator+(const Vec& a, const Vec& b) { return Vec{ a[0]+b[0], a[1]+b[1], a[2]+b[2] }; }
+inline Vec operator-(const Vec& a, const Vec& b) { return Vec{ a[0]-b[0], a[1]-b[1], a[2]-b[2] }; }
+inline Vec operator*(double s, const Vec& a)     { return Vec{ s*a[0], s*a[1], s*a[2] }; }
+
+inline double Distance(const Vec& a, const Vec& b)
+{
+    double dx=a[0]-b[0], dy=a[1]-b[1], dz=a[2]-b[2];
+    return sqrt(dx*dx+dy*dy+dz*dz);
+}
+
+inline double Uniform(mt19937& rng) { return generate_canonical<double, 53>(rng); }
+
+// Random direction scaled by r
+Vec Direction(mt19937& rng, double r)
+{
+    double c   = 2*Uniform(rng)-1;
+    double phi = 2*M_PI*Uniform(rng);
+    double s   = sqrt(max(0.0, 1-c*c));
+    return Vec{ r*s*cos(phi), r*s*sin(phi), r*c };
+}
+
+// Random point in a spherical shell from Ri to Ro, Ri=Ro gives the surface.
+Vec InShell(mt19937& rng, double Ri, double Ro)
+{
+    double Ri3 = Ri*Ri*Ri;
+    return Direction(rng, cbrt( Ri3 + (Ro*Ro*Ro-Ri3)*Uniform(rng) ));
+}
+
+// Random point on the inner or outer surface of a shell weighted by their areas.
+Vec OnShellSurface(mt19937& rng, double Ri, double Ro)
+{
+    return Direction(rng, Uniform(rng)*(Ri*Ri+Ro*Ro) < Ro*Ro ? Ro : Ri);
+}
+
+// Random point on a disk with radius from Ri to Ro in the xy plane, Ri=Ro gives a circle.
+Vec InAnnulus(mt19937& rng, double Ri, double Ro, double z=0)
+{
+    double r   = sqrt( Ri*Ri + (Ro*Ro-Ri*Ri)*Uniform(rng) );
+    double phi = 2*M_PI*Uniform(rng);
+    return Vec{ r*cos(phi), r*sin(phi), z };
+}
+
+// Points on a cylinder with axis along z, centered at the origin.
+Vec CylinderHull(mt19937& rng, double R, double L) { return InAnnulus(rng, R, R, L*(Uniform(rng)-0.5)); }
+Vec CylinderEnds(mt19937& rng, double R, double L) { return InAnnulus(rng, 0, R, Uniform(rng)<0.5 ? -L/2 : L/2); }
+Vec CylinderSurface(mt19937& rng, double R, double L) { return Uniform(rng)*(L+R) < L ? CylinderHull(rng, R, L) : CylinderEnds(rng, R, L); }
+
+// Rotates v from a frame with z along u to the lab frame.
+Vec Rotate(const Vec& v, const Vec& u)
+{
+    Vec a = fabs(u[0]) < 0.9 ? Vec{1,0,0} : Vec{0,1,0};
+    Vec e1{ a[1]*u[2]-a[2]*u[1], a[2]*u[0]-a[0]*u[2], a[0]*u[1]-a[1]*u[0] };
+    e1 = (1/sqrt(e1[0]*e1[0]+e1[1]*e1[1]+e1[2]*e1[2]))*e1;
+    Vec e2{ u[1]*e1[2]-u[2]*e1[1], u[2]*e1[0]-u[0]*e1[2], u[0]*e1[1]-u[1]*e1[0] };
+    return v[0]*e1 + v[1]*e2 + v[2]*u;
+}
+
+// sin(x)/x and its first and second derivatives.
+inline double sinc(double x)  { return fabs(x)<1e-3 ? 1-x*x/6 : sin(x)/x; }
+inline double sinc1(double x) { return fabs(x)<1e-2 ? -x/3+x*x*x/30 : (x*cos(x)-sin(x))/(x*x); }
+inline double sinc2(double x) { return fabs(x)<1e-2 ? -1.0/3+x*x/10 : -sin(x)/x - 2*cos(x)/(x*x) + 2*sin(x)/(x*x*x); }
+
+}
+
+
+/*
+   Weights of distances binned with width dr. Each bin keeps the sum of weights and of the weighted first
+   and second moment of the distances around its center c, such that
+
+        sum w sinc(q r) = W0 sinc(qc) + q W1 sinc'(qc) + q^2 W2 sinc''(qc)/2 + O((q dr)^3)
+
+   which holds for weights of either sign.
+*/
+struct Simulator::Histogram
+{
+    double dr;
+    vector<double> w0, w1, w2;
+
+    void add(const Vec& a, const Vec& b, double w)
+      {
+         double r = Distance(a, b);
+         size_t k = r/dr;
+         if (k>=w0.size())
+           {
+              w0.resize(k+1, 0.0);
+              w1.resize(k+1, 0.0);
+              w2.resize(k+1, 0.0);
+           }
+         double d = r-(k+0.5)*dr;
+         w0[k] += w;
+         w1[k] += w*d;
+         w2[k] += w*d*d;
+      }
+
+    void Transform(const DoubleVector& q, DoubleVector& I)
+      {
+         for (size_t k=0; k<w0.size(); k++)
+           {
+              if (w0[k]==0 && w2[k]==0) continue;
+              double c = (k+0.5)*dr;
+              for (size_t i=0; i<q.size(); i++)
+                {
+                   double x = q[i]*c;
+                   I[i] += w0[k]*sinc(x) + q[i]*w1[k]*sinc1(x) + 0.5*q[i]*q[i]*w2[k]*sinc2(x);
+                }
+           }
+      }
+};
+
+
+Simulator::Simulator(World& w, string n, ParameterList& pl)
+try
+{
+    GiNaCLock lock;
+    name = n;
+
+    // Links grouped by the graph they were made in.
+    map<GraphID, vector<link>> graphlinks;
+    for (auto& l : w.links)
+        graphlinks[ w.graphOfName.at(w.prefix(l.first)) ].push_back(l);
+
+    Flatten(w, name, name, pl, graphlinks);
+
+    for (auto& in : instances) sumbeta += in.beta;
+    Place();
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Simulator::Simulator(World&, "+n+", ParameterList&)");
+    throw;
+}
+
+double Simulator::Value(World& w, string symb, string tag, ParameterList& pl)
+{
+    ex s = w.GetSymbolInterface()->getSymbol(symb, tag);
+    auto it = pl.find(s);
+    if (it==pl.end()) throw SEBException("Parameter "+symb+"_"+tag+" is needed for simulating "+name+", but is not set");
+
+    ex v = it->second.evalf();
+    if (!is_a<numeric>(v)) throw SEBException("Parameter "+symb+"_"+tag+" does not have a numerical value");
+    return ex_to<numeric>(v).to_double();
+}
+
+int Simulator::Reference(string ref)
+{
+    auto it = refIndex.find(ref);
+    if (it!=refIndex.end()) return it->second;
+
+    parent.push_back(parent.size());
+    refIndex[ref] = parent.back();
+    return parent.back();
+}
+
+int Simulator::Find(int i)
+{
+    while (parent[i]!=i) i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+void Simulator::AddReference(Instance& in, string ref)
+{
+    in.refs.push_back(ref);
+    in.base.push_back(ref.substr(0, ref.find("#")));
+    in.cls.push_back(Reference(in.path+"."+ref));
+}
+
+void Simulator::Flatten(World& w, string n, string path, ParameterList& pl, map<GraphID, vector<link>>& graphlinks)
+{
+    if (w.isSubunit(n))
+      {
+         Instance in;
+         in.path = path;
+         in.sub  = w.getSubunit(n);
+         in.type = in.sub->getSubunitType();
+
+         string tag = in.sub->getTag();
+         switch (in.type)
+           {
+             case POINT:               break;
+             case GAUSSIANPOLYMER:
+             case GAUSSIANLOOP:        in.p1 = Value(w, "Rg", tag, pl);  break;
+             case THINROD:             in.p1 = Value(w, "L",  tag, pl);  break;
+             case THINCIRCLE:
+             case THINDISK:
+             case THINSPHERICALSHELL:
+             case SOLIDSPHERE:         in.p1 = Value(w, "R",  tag, pl);  break;
+             case SOLIDSPHERICALSHELL: in.p1 = Value(w, "Ri", tag, pl);  in.p2 = Value(w, "Ro", tag, pl);  break;
+             case SOLIDCYLINDER:       in.p1 = Value(w, "R",  tag, pl);  in.p2 = Value(w, "L",  tag, pl);  break;
+             default: throw SEBException("Sub-unit "+n+" has no geometry and can not be simulated");
+           }
+         in.beta = in.type==POINT ? 0 : Value(w, "beta", tag, pl);      // Points are invisible.
+
+         for (auto& ref : *in.sub->getReferencePoints())
+             AddReference(in, ref);
+
+         instanceOf[path] = instances.size();
+         instances.push_back(in);
+         return;
+      }
+
+    GraphID gid = w.getStructure(n)->getGraphID();
+    for (auto it = w.subgraph_cbegin(gid); it != w.subgraph_cend(gid); ++it)
+        Flatten(w, *it, path+":"+*it, pl, graphlinks);
+
+    for (auto& l : graphlinks[gid])
+        parent[ Find(Reference(path+":"+l.first)) ] = Find(Reference(path+":"+l.second));
+}
+
+void Simulator::Place()
+{
+    // Number the classes of linked reference points
+    map<int, int> id;
+    for (auto& in : instances)
+        for (auto& c : in.cls)
+          {
+             int root = Find(c);
+             if (id.find(root)==id.end()) id[root] = classes++;
+             c = id[root];
+          }
+
+    vector<vector<pair<int, int>>> members(classes);
+    for (size_t i=0; i<instances.size(); i++)
+        for (size_t r=0; r<instances[i].cls.size(); r++)
+            members[ instances[i].cls[r] ].push_back( make_pair(i, r) );
+
+    // Breadth first through links, every instance is placed by the reference point it was reached by.
+    vector<bool> placed(instances.size(), false);
+    for (size_t s=0; s<instances.size(); s++)
+      {
+         if (placed[s]) continue;
+         placed[s] = true;
+         order.push_back( make_pair(s, -1) );
+
+         queue<int> todo;
+         todo.push(s);
+         while (!todo.empty())
+           {
+              int i = todo.front();
+              todo.pop();
+              for (int c : instances[i].cls)
+                 for (auto& m : members[c])
+                    if (!placed[m.first])
+                      {
+                         placed[m.first] = true;
+                         order.push_back(m);
+                         todo.push(m.first);
+                      }
+           }
+      }
+}
+
+pair<int, int> Simulator::Resolve(string ref)
+{
+    size_t dot = ref.rfind(".");
+    if (dot==string::npos) throw SEBException("Reference point "+ref+" has no .");
+
+    auto it = instanceOf.find(ref.substr(0, dot));
+    if (it==instanceOf.end()) throw SEBException("No sub-unit "+ref.substr(0, dot)+" in "+name);
+
+    Instance& in = instances[it->second];
+    string r = ref.substr(dot+1);
+    for (size_t k=0; k<in.refs.size(); k++)
+        if (in.refs[k]==r) return make_pair(it->second, k);
+
+    // A distributed reference point that was not linked, draw it as well.
+    if (!in.sub->hasDistributedReference(r.substr(0, r.find("#"))))
+        throw SEBException("Sub-unit "+in.path+" has no reference point "+r);
+
+    AddReference(in, r);
+    in.cls.back() = classes++;
+    return make_pair(it->second, in.refs.size()-1);
+}
+
+void Simulator::Generate(const Instance& in, mt19937& rng, vector<Vec>& local)
+{
+    size_t n = in.refs.size();
+    local.assign(n+2, Vec{0,0,0});
+
+    switch (in.type)
+      {
+        case POINT:
+           break;
+
+        case GAUSSIANPOLYMER:
+        case GAUSSIANLOOP:
+          {
+             // Contour fraction of each point, walked in increasing order.
+             vector<double> t(n+2);
+             for (size_t r=0; r<n; r++)
+                 t[r] = in.base[r]=="end1" ? 0 : in.base[r]=="end2" ? 1 : in.base[r]=="middle" ? 0.5 : Uniform(rng);
+             t[n]   = Uniform(rng);
+             t[n+1] = Uniform(rng);
+
+             vector<int> idx(n+2);
+             iota(idx.begin(), idx.end(), 0);
+             sort(idx.begin(), idx.end(), [&](int a, int b){ return t[a]<t[b]; });
+
+             // Mean square displacement per component along the whole contour, bL/3 for a chain of bL=6Rg^2, and for a loop of bL=12Rg^2.
+             bool loop = in.type==GAUSSIANLOOP;
+             double var = (loop ? 4 : 2)*in.p1*in.p1;
+
+             normal_distribution<double> g(0.0, 1.0);
+             Vec x{0,0,0};
+             double last = 0;
+             for (int k : idx)
+               {
+                  double s = sqrt(var*(t[k]-last));
+                  x = x + s*Vec{ g(rng), g(rng), g(rng) };
+                  local[k] = x;
+                  last = t[k];
+               }
+
+             // Brownian bridge, subtract the drift to the end point of the free walk.
+             if (loop)
+               {
+                  double s = sqrt(var*(1-last));
+                  Vec end = x + s*Vec{ g(rng), g(rng), g(rng) };
+                  for (size_t k=0; k<n+2; k++) local[k] = local[k] - t[k]*end;
+               }
+             break;
+          }
+
+        case THINROD:
+          {
+             Vec u = Direction(rng, in.p1);
+             for (size_t r=0; r<n; r++)
+                 local[r] = (in.base[r]=="end1" ? 0 : in.base[r]=="end2" ? 1 : in.base[r]=="middle" ? 0.5 : Uniform(rng))*u;
+             local[n]   = Uniform(rng)*u;
+             local[n+1] = Uniform(rng)*u;
+             break;
+          }
+
+        case SOLIDSPHERE:
+        case THINSPHERICALSHELL:
+        case SOLIDSPHERICALSHELL:
+          {
+             double Ri = in.type==SOLIDSPHERICALSHELL ? in.p1 : in.type==SOLIDSPHERE ? 0 : in.p1;
+             double Ro = in.type==SOLIDSPHERICALSHELL ? in.p2 : in.p1;
+             for (size_t r=0; r<n; r++)
+               {
+                  if      (in.base[r]=="center")   local[r] = Vec{0,0,0};
+                  else if (in.base[r]=="surface")  local[r] = in.type==SOLIDSPHERICALSHELL ? OnShellSurface(rng, Ri, Ro) : Direction(rng, Ro);
+                  else if (in.base[r]=="surfaceo") local[r] = Direction(rng, Ro);
+                  else if (in.base[r]=="surfacei") local[r] = Direction(rng, Ri);
+                  else throw SEBException("Can not simulate reference point "+in.refs[r]+" of "+in.path);
+               }
+             local[n]   = InShell(rng, Ri, Ro);
+             local[n+1] = InShell(rng, Ri, Ro);
+             break;
+          }
+
+        case SOLIDCYLINDER:
+        case THINDISK:
+        case THINCIRCLE:
+          {
+             double R = in.p1, L = in.p2;
+             double Ri = in.type==THINCIRCLE ? R : 0;
+             for (size_t r=0; r<n; r++)
+               {
+                  if      (in.base[r]=="center")                              local[r] = Vec{0,0,0};
+                  else if (in.base[r]=="hull")                                local[r] = CylinderHull(rng, R, L);
+                  else if (in.base[r]=="ends")                                local[r] = CylinderEnds(rng, R, L);
+                  else if (in.base[r]=="surface" && in.type==SOLIDCYLINDER)   local[r] = CylinderSurface(rng, R, L);
+                  else if (in.base[r]=="surface")                             local[r] = InAnnulus(rng, 0, R);
+                  else if (in.base[r]=="rim" || in.base[r]=="contour")        local[r] = InAnnulus(rng, R, R);
+                  else throw SEBException("Can not simulate reference point "+in.refs[r]+" of "+in.path);
+               }
+             for (size_t k=n; k<n+2; k++)
+                 local[k] = in.type==SOLIDCYLINDER ? InAnnulus(rng, 0, R, L*(Uniform(rng)-0.5)) : InAnnulus(rng, Ri, R);
+
+             // Random orientation of the axis.
+             Vec u = Direction(rng, 1);
+             for (auto& x : local) x = Rotate(x, u);
+             break;
+          }
+
+        default:
+           throw SEBException("Sub-unit "+in.path+" can not be simulated");
+      }
+}
+
+void Simulator::Generate(mt19937& rng, Conformation& c)
+{
+    c.pos.resize(classes);
+    c.s1.resize(instances.size());
+    c.s2.resize(instances.size());
+
+    for (auto& o : order)
+      {
+         const Instance& in = instances[o.first];
+         Generate(in, rng, c.local);
+
+         size_t n = in.refs.size();
+         Vec shift = o.second<0 ? Vec{0,0,0} : c.pos[ in.cls[o.second] ] - c.local[o.second];
+         for (size_t r=0; r<n; r++) c.pos[ in.cls[r] ] = c.local[r] + shift;
+         c.s1[o.first] = c.local[n]   + shift;
+         c.s2[o.first] = c.local[n+1] + shift;
+      }
+}
+
+DoubleVector Simulator::Average(DoubleVector& q, long conformations, const std::function<void(Conformation&, Histogram&)>& add)
+{
+    if (conformations<=0) throw SEBException("Number of conformations must be positive");
+
+    double qmax = 0;
+    for (double x : q) qmax = max(qmax, x);
+
+    // Each block transforms its own histogram, the blocks are summed in order afterwards.
+    long blocks = (conformations+blocksize-1)/blocksize;
+    vector<DoubleVector> I(blocks, DoubleVector(q.size(), 0.0));
+
+    ParallelTasks(blocks, [&](int b)
+      {
+         seed_seq seq{ seed, (unsigned) b };
+         mt19937 rng(seq);
+
+         Conformation c;
+         Histogram h;
+         h.dr = qmax>0 ? 0.05/qmax : 1;
+
+         for (long k=(long) b*blocksize; k<min(conformations, (long) (b+1)*blocksize); k++)
+           {
+              Generate(rng, c);
+              add(c, h);
+           }
+         h.Transform(q, I[b]);
+      });
+
+    DoubleVector total(q.size(), 0.0);
+    for (auto& Ib : I)
+        for (size_t i=0; i<q.size(); i++) total[i] += Ib[i];
+    for (auto& x : total) x /= conformations;
+
+    return total;
+}
+
+DoubleVector Simulator::FormFactor(DoubleVector& q, long conformations)
+try
+{
+    if (sumbeta==0) throw SEBException("The sum of excess scattering lengths of "+name+" is zero");
+
+    vector<double> beta;
+    for (auto& in : instances) beta.push_back(in.beta);
+
+    DoubleVector F = Average(q, conformations, [&](Conformation& c, Histogram& h)
+      {
+         for (size_t i=0; i<beta.size(); i++)
+           {
+              if (beta[i]==0) continue;
+              h.add(c.s1[i], c.s2[i], beta[i]*beta[i]);
+              for (size_t j=i+1; j<beta.size(); j++)
+                  if (beta[j]!=0) h.add(c.s1[i], c.s1[j], 2*beta[i]*beta[j]);
+           }
+      });
+
+    for (auto& x : F) x /= sumbeta*sumbeta;
+    return F;
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Simulator::FormFactor(DoubleVector&, "+to_string(conformations)+")");
+    throw;
+}
+
+DoubleVector Simulator::FormFactorAmplitude(string ref, DoubleVector& q, long conformations)
+try
+{
+    if (sumbeta==0) throw SEBException("The sum of excess scattering lengths of "+name+" is zero");
+
+    pair<int, int> r = Resolve(ref);
+    int k = instances[r.first].cls[r.second];
+
+    vector<double> beta;
+    for (auto& in : instances) beta.push_back(in.beta);
+
+    DoubleVector A = Average(q, conformations, [&](Conformation& c, Histogram& h)
+      {
+         for (size_t i=0; i<beta.size(); i++)
+             h.add(c.s1[i], c.pos[k], beta[i]);
+      });
+
+    for (auto& x : A) x /= sumbeta;
+    return A;
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Simulator::FormFactorAmplitude("+ref+", DoubleVector&, "+to_string(conformations)+")");
+    throw;
+}
+
+DoubleVector Simulator::PhaseFactor(string r1, string r2, DoubleVector& q, long conformations)
+try
+{
+    pair<int, int> a = Resolve(r1);
+    pair<int, int> b = Resolve(r2);
+    int k1 = instances[a.first].cls[a.second];
+    int k2 = instances[b.first].cls[b.second];
+
+    return Average(q, conformations, [&](Conformation& c, Histogram& h)
+      {
+         h.add(c.pos[k1], c.pos[k2], 1);
+      });
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("Simulator::PhaseFactor("+r1+", "+r2+", DoubleVector&, "+to_string(conformations)+")");
+    throw;
+}
@@ -0,0 +1,139 @@
+//===========================================================================
+// Included guards
+#ifndef INCLUDE_GUARD_SIMULATOR
+#define INCLUDE_GUARD_SIMULATOR
+
+//===========================================================================
+// included dependencies
+#include <vector>
+#include <map>
+#include <array>
+#include <random>
+#include <functional>
+
+#include "World.hpp"
+
+//===========================================================================
+// used namespaces
+using namespace std;
+using namespace GiNaC;
+
+/*
+    Simulator generates explicit 3D conformations of a structure in a World, and estimates its form factor,
+    form factor amplitudes and phase factors by Monte Carlo. This provides an independent check of the
+    expressions SEB derives for composite structures, e.g. DiBlockStarChain or Micelle.
+
+    The structure is flattened into its sub-units, and the links of all nested structures are followed to
+    place one sub-unit after the other: each sub-unit is generated in a random orientation, and translated
+    such that the reference point it is linked by coincides with the reference point it is linked to.
+
+        GaussianPolymer   random walk, positions are drawn exactly at the contour fractions needed.
+        GaussianLoop      Brownian bridge, i.e. a random walk returning to its start.
+        ThinRod           straight rod in a random direction.
+        Spheres, shells, cylinders, disks and circles   uniformly sampled points in a random orientation.
+
+    Distributed reference points (contour#x, surface#y, and plain contour, surface, ...) are drawn anew for
+    every conformation. Symbolic sub-units can not be simulated.
+
+    Every sub-unit contributes two independent random scatterers to each conformation, such that
+
+        F   = [ sum_i beta_i^2 sinc(q|s_i-s_i'|) + sum_i!=j beta_i beta_j sinc(q|s_i-s_j|) ] / (sum beta)^2
+        A   = sum_i beta_i sinc(q|s_i-R|) / sum beta
+        Psi = sinc(q|R1-R2|)
+
+    averaged over conformations. Distances are binned in a histogram with width 0.05/qmax, and the Debye
+    transform is corrected to second order within each bin.
+
+    Conformations are generated on all cores in blocks, each with its own random stream seeded from (seed, block),
+    and blocks are summed in order. Hence results only depend on the seed and not on the number of threads.
+
+    Usage:
+        Simulator sim(w, "micelle", params);                         // Numerical parameters from params
+        DoubleVector F = sim.FormFactor(q, 10000);                   // Averaged over 10000 conformations
+        DoubleVector A = sim.FormFactorAmplitude("micelle:sphere.center", q, 10000);
+*/
+
+class Simulator
+{
+private:
+
+    typedef array<double, 3> Vec;
+
+    // A sub-unit inside the structure
+    struct Instance
+    {
+        string path;                 // e.g. chain:star1:diblock1:polyB
+        SubUnit* sub;
+        int type;                    // subunittypes
+        double beta;
+        double p1 = 0, p2 = 0;       // Rg, L, R or Ri for the type, and L or Ro for cylinders and shells.
+        vector<string> refs;         // Reference points generated for each conformation.
+        vector<string> base;         // Their base names, e.g. contour for contour#x
+        vector<int> cls;             // Class of coinciding reference points of each ref (index in parent until Place).
+    };
+
+    // Positions in one conformation
+    struct Conformation
+    {
+        vector<Vec> pos;             // Position of each class of reference points
+        vector<Vec> s1, s2;          // Two random scatterers of each instance.
+        vector<Vec> local;           // Refs and scatterers of the instance being placed.
+    };
+
+    // Weighted histogram of distances, see Simulator.cpp
+    struct Histogram;
+
+    string name;
+    vector<Instance> instances;
+    vector<int> parent;               // Union-find over reference points linked together
+    map<string, int> refIndex;        // Full path to reference point (e.g. micelle:poly0.end1) -> index in parent
+    map<string, int> instanceOf;      // Full path to sub-unit -> instance
+    vector<pair<int, int>> order;     // Instances in the order they are placed, with the ref they are placed by (-1 for none)
+    int classes = 0;
+    double sumbeta = 0;
+    unsigned seed = 1;
+    int blocksize = 256;              // Conformations per block.
+
+    // Adds instances for all sub-units below name, and unites the linked reference points.
+    void Flatten(World& w, string name, string path, ParameterList& pl, map<GraphID, vector<link>>& graphlinks);
+    void AddReference(Instance& in, string ref);
+    int Reference(string ref);
+    int Find(int i);
+
+    // Numerical value of the parameter name_tag
+    double Value(World& w, string symb, string tag, ParameterList& pl);
+
+    // Classes of reference points and the order instances are placed in.
+    void Place();
+
+    // Resolves a path to a reference point into its instance and ref, adding the ref to the instance if needed.
+    pair<int, int> Resolve(string ref);
+
+    // Draws the positions of the refs and two scatterers of an instance in its own frame.
+    static void Generate(const Instance& in, mt19937& rng, vector<Vec>& local);
+
+    // Draws a conformation, the sub-unit placed first is located at the origin.
+    void Generate(mt19937& rng, Conformation& c);
+
+    // Average of the Debye transform over conformations, where add(conformation, histogram) adds weighted distances.
+    DoubleVector Average(DoubleVector& q, long conformations, const std::function<void(Conformation&, Histogram&)>& add);
+
+public:
+
+    // Flattens structure (or sub-unit) name in w, with parameter values taken from pl.
+    Simulator(World& w, string name, ParameterList& pl);
+
+    // Seed for the random streams, results only depend on the seed.
+    void setSeed(unsigned s) { seed = s; }
+
+    // Number of sub-units in the structure.
+    int Subunits() const { return instances.size(); }
+
+    // Estimates of the normalized form factor, form factor amplitude relative to ref and phase factor between r1 and r2.
+    // References are full paths as for World, e.g. micelle:sphere.center
+    DoubleVector FormFactor(DoubleVector& q, long conformations);
+    DoubleVector FormFactorAmplitude(string ref, DoubleVector& q, long conformations);
+    DoubleVector PhaseFactor(string r1, string r2, DoubleVector& q, long conformations);
+};
+
+#endif // INCLUDE_GUARD_SIMULATOR
@@ -0,0 +1,179 @@
+/*
+    Analytic structure factors and the decoupling approximation.
+    See StructureFactors.hpp for references.
+*/
+
+#include "StructureFactors.hpp"
+
+#include <cmath>
+
+
+DoubleVector StructureFactor::S(const DoubleVector& q) const
+{
+    DoubleVector s(q.size());
+    for (size_t i=0; i<q.size(); i++) s[i] = S(q[i]);
+    return s;
+}
+
+
+/*
+    Percus-Yevick hard spheres:
+
+        S(q) = 1/(1+24 phi G(x)/x)        x=2qR
+
+    For small x, G(x)/x suffers from cancellations and is replaced by its series expansion.
+*/
+
+HardSpherePY::HardSpherePY(double r, double p) : R(r), phi(p)
+{
+    if (R<=0)             throw SEBException("Hard sphere radius must be positive", "HardSpherePY::HardSpherePY("+to_string(r)+","+to_string(p)+")");
+    if (phi<0 || phi>=1)  throw SEBException("Volume fraction must be in [0:1)",   "HardSpherePY::HardSpherePY("+to_string(r)+","+to_string(p)+")");
+
+    double d = pow(1-phi, 4);
+    alpha = pow(1+2*phi, 2)/d;
+    beta  = -6*phi*pow(1+phi/2, 2)/d;
+    gamma = phi*alpha/2;
+}
+
+double HardSpherePY::S(double q) const
+{
+    double x = 2*q*R;
+    double Gx;
+
+    if (x<0.2)
+      {
+        double x2 = x*x, x4 = x2*x2;
+        Gx =  alpha*(1.0/3 - x2/30 + x4/840)
+            + beta *(1.0/4 - x2/36 + x4/960)
+            + gamma*(1.0/6 - x2/48 + x4/1200);
+      }
+    else
+      {
+        double s = sin(x), c = cos(x);
+        double x2 = x*x, x3 = x2*x, x4 = x2*x2;
+        Gx = (  alpha*(s-x*c)/x2
+              + beta *(2*x*s+(2-x2)*c-2)/x3
+              + gamma*(-x4*c+4*((3*x2-6)*c+(x3-6*x)*s+6))/(x4*x) )/x;
+      }
+
+    return 1/(1+24*phi*Gx);
+}
+
+
+/*
+    Sticky hard spheres. Lambda is the smaller root of  eta/12 lambda^2 - (tau+eta/(1-eta)) lambda + (1+eta/2)/(1-eta)^2 = 0.
+*/
+
+StickyHardSphere::StickyHardSphere(double R, double phi, double tau, double perturbation)
+{
+    string where = "StickyHardSphere::StickyHardSphere("+to_string(R)+","+to_string(phi)+","+to_string(tau)+","+to_string(perturbation)+")";
+
+    if (R<=0)                                throw SEBException("Hard sphere radius must be positive", where);
+    if (phi<=0 || phi>=1)                    throw SEBException("Volume fraction must be in (0:1)", where);
+    if (tau<=0)                              throw SEBException("Stickiness must be positive", where);
+    if (perturbation<=0 || perturbation>=1)  throw SEBException("Perturbation must be in (0:1)", where);
+
+    double onemineps = 1-perturbation;
+    eta = phi/pow(onemineps, 3);
+    aa  = 2*R/onemineps;
+
+    double etam1 = 1-eta;
+    double etam1sq = etam1*etam1;
+
+    double qa = eta/6;
+    double qb = tau+eta/etam1;
+    double qc = (1+eta/2)/etam1sq;
+    double radic = qb*qb-2*qa*qc;
+    if (radic<0) throw SEBException("Unphysical parameters, no real solution for lambda", where);
+
+    radic = sqrt(radic);
+    lambda = min( (qb-radic)/qa, (qb+radic)/qa );
+
+    double mu = lambda*eta*etam1;
+    if (mu>1+2*eta) throw SEBException("Unphysical parameters, mu>1+2 eta", where);
+
+    alpha = (1+2*eta-mu)/etam1sq;
+    beta  = (mu-3*eta)/(2*etam1sq);
+}
+
+double StickyHardSphere::S(double q) const
+{
+    double k = q*aa;
+    double a1, a2, a3, b1, b2, b3;
+
+    if (k<0.01)
+      {
+        double k2 = k*k, k3 = k2*k, k4 = k2*k2;
+        a1 = 1.0/3 - k2/30 + k4/840;      // (sin k - k cos k)/k^3
+        a2 = 0.5   - k2/24 + k4/720;      // (1-cos k)/k^2
+        a3 = 1.0   - k2/6  + k4/120;      // sin k/k
+        b1 = k/8   - k3/144;              // 1/(2k) - sin k/k^2 + (1-cos k)/k^3
+        b2 = k/6   - k3/120;              // 1/k - sin k/k^2
+        b3 = k/2   - k3/24;               // (1-cos k)/k
+      }
+    else
+      {
+        double s = sin(k), c = cos(k);
+        double k2 = k*k, k3 = k2*k;
+        a1 = (s-k*c)/k3;
+        a2 = (1-c)/k2;
+        a3 = s/k;
+        b1 = 0.5/k-s/k2+(1-c)/k3;
+        b2 = 1/k-s/k2;
+        b3 = (1-c)/k;
+      }
+
+    double aq = 1+12*eta*(alpha*a1+beta*a2-lambda*a3/12);
+    double bq = 12*eta*(alpha*b1+beta*b2-lambda*b3/12);
+
+    return 1/(aq*aq+bq*bq);
+}
+
+
+/*
+    Decoupling approximation
+*/
+
+DecouplingModel::DecouplingModel(const ex& F, const ex& A, const ex& q) : ev( vector<ex>{F, A} ), qsymbol(q)
+{
+}
+
+void DecouplingModel::Compute(const ParameterList& pl, const DoubleVector& q)
+try
+{
+    vector<DoubleVector> r = ev.Evaluate(pl, qsymbol, q);
+
+    qvalues = q;
+    Fq  = r[0];
+    A2q = r[1];
+    for (auto& a : A2q) a *= a;
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("DecouplingModel::Compute(ParameterList&, DoubleVector&)");
+    throw;
+}
+
+void DecouplingModel::Compute(const ParameterList& pl, const DoubleVector& q, const Polydispersity& pd)
+try
+{
+    vector<DoubleVector> r = pd.Average(ev, pl, qsymbol, q);
+
+    qvalues = q;
+    Fq  = r[0];
+    A2q = r[1];
+    for (auto& a : A2q) a *= a;
+}
+catch (SEBException& e)
+{
+    e.PushCallStack("DecouplingModel::Compute(ParameterList&, DoubleVector&, Polydispersity&)");
+    throw;
+}
+
+DoubleVector DecouplingModel::Intensity(const StructureFactor& S) const
+{
+    DoubleVector I(qvalues.size());
+    for (size_t i=0; i<qvalues.size(); i++)
+        I[i] = Fq[i]+A2q[i]*(S.S(qvalues[i])-1);
+    return I;
+}
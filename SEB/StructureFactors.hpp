@@ -0,0 +1,108 @@
+//===========================================================================
+// Included guards
+#ifndef INCLUDE_GUARD_STRUCTUREFACTORS
+#define INCLUDE_GUARD_STRUCTUREFACTORS
+
+//===========================================================================
+// included dependencies
+#include <vector>
+
+#include "Types.hpp"
+#include "Exceptions.hpp"
+#include "Evaluator.hpp"
+#include "Polydispersity.hpp"
+
+//===========================================================================
+// used namespaces
+using namespace std;
+using namespace GiNaC;
+
+/*
+    Analytic structure factors S(q) for interacting particles, and the decoupling approximation
+
+          I(q) = F(q) + A(q)^2 (S(q)-1)
+
+    where F is the form factor of a structure, and A its form factor amplitude relative to the reference
+    point that is assumed to be the centre of interaction (e.g. the core centre of a micelle).
+*/
+
+class StructureFactor
+{
+public:
+    virtual ~StructureFactor() {};
+
+    // Structure factor at a single q value.
+    virtual double S(double q) const = 0;
+
+    // Structure factor at a vector of q values.
+    DoubleVector S(const DoubleVector& q) const;
+};
+
+// No interactions, S(q)=1.
+class DiluteStructureFactor : public StructureFactor
+{
+public:
+    using StructureFactor::S;
+    double S(double q) const { return 1.0; }
+};
+
+/*
+    Hard spheres of radius R at volume fraction phi in the Percus-Yevick approximation.
+    Ref: Kinning and Thomas, Macromolecules 17, 1712 (1984).
+*/
+class HardSpherePY : public StructureFactor
+{
+    double R, phi;
+    double alpha, beta, gamma;
+
+public:
+    HardSpherePY(double R, double phi);
+
+    using StructureFactor::S;
+    double S(double q) const;
+};
+
+/*
+    Baxter's sticky hard spheres of radius R at volume fraction phi with stickiness parameter tau,
+    solved by perturbation, where perturbation is the relative width of the attractive well.
+    Ref: Menon, Manohar and Rao, J. Chem. Phys. 95, 9186 (1991).
+*/
+class StickyHardSphere : public StructureFactor
+{
+    double eta, aa, lambda, alpha, beta;
+
+public:
+    StickyHardSphere(double R, double phi, double tau, double perturbation = 0.05);
+
+    using StructureFactor::S;
+    double S(double q) const;
+};
+
+/*
+    DecouplingModel compiles F and A of a structure into a single Evaluator, such that sub-unit terms shared
+    between the two are evaluated only once. After Compute, intensities for any number of structure factors
+    (e.g. a concentration series) are obtained at negligible cost. With polydispersity F and A^2 are replaced
+    by <F> and <A>^2.
+*/
+class DecouplingModel
+{
+    Evaluator ev;
+    ex qsymbol;
+    DoubleVector qvalues, Fq, A2q;
+
+public:
+    DecouplingModel(const ex& F, const ex& A, const ex& q);
+
+    // Evaluate F and A^2 for the given parameters and q values.
+    void Compute(const ParameterList& pl, const DoubleVector& q);
+    void Compute(const ParameterList& pl, const DoubleVector& q, const Polydispersity& pd);
+
+    const DoubleVector& getq()                const { return qvalues; }
+    const DoubleVector& getFormFactor()       const { return Fq; }
+    const DoubleVector& getAmplitudeSquared() const { return A2q; }
+
+    // I(q) = F + A^2 (S-1) at the q values of the last Compute.
+    DoubleVector Intensity(const StructureFactor& S) const;
+};
+
+#endif // INCLUDE_GUARD_STRUCTUREFACTORS
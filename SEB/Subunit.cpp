@@ -15,13 +15,13 @@ ex SubUnit::FormFactor(ParameterList&  betas, ParameterList&  params, int varFor
                                     }
     else if (varForm == XVAR)       {
                                       betas[beta]=0;
-                                      for (auto& p:xparameters) params[p]=0;
-                                      return beta*beta*FormFactorExpression;
+                                      for (auto& p:terms()->xparameters) params[p]=0;
+                                      return beta*beta*terms()->FormFactorExpression;
                                     }
     else if (varForm == QVAR)       {
                                       betas[beta]=0;
-                                      for (auto& p:parameters) params[p]=0;
-                                      return beta*beta*FormFactorExpression.subs( expand );
+                                      for (auto& p:terms()->parameters) params[p]=0;
+                                      return beta*beta*terms()->ExpandedFormFactor();
                                     }
     else if (varForm == BETA)       {
                                       betas[beta]=0;
@@ -31,10 +31,10 @@ ex SubUnit::FormFactor(ParameterList&  betas, ParameterList&  params, int varFor
     else if (varForm == GUINIER)    
                                     {
                                       betas[beta]=0;
-                                      for (auto& p:parameters) params[p]=0;
+                                      for (auto& p:terms()->parameters) params[p]=0;
 
                                       symbol q=GLEX->getSymbol("q");
-                                      return beta*beta*(1-q*q*2*RadiusOfGyration2/6);
+                                      return beta*beta*(1-q*q*2*terms()->RadiusOfGyration2/6);
                                     }
     else
                                     throw SEBException("Wrong varform constant");
@@ -60,11 +60,11 @@ ex SubUnit::FormFactorAmplitude(refPoint r, ParameterList&  betas, ParameterList
 
     if (hasAHash(r)) r = removeHashString(r);
     
-    if ( (varForm == XVAR || varForm == QVAR)  && FormFactorAmplitudeExpressions.find(r)==FormFactorAmplitudeExpressions.end()) 
+    if ( (varForm == XVAR || varForm == QVAR)  && terms()->FormFactorAmplitudeExpressions.find(r)==terms()->FormFactorAmplitudeExpressions.end()) 
                              throw SEBException("Invalid reference point not found in FormFactorAmplitudesExpressions table");
 
     if (varForm == GUINIER)
-         if (sigmaMSDref2scat.find(r)==sigmaMSDref2scat.end()) 
+         if (terms()->sigmaMSDref2scat.find(r)==terms()->sigmaMSDref2scat.end()) 
                              throw SEBException("Invalid reference point not found in sigmaMSDref2scat table");
 
 
@@ -78,14 +78,14 @@ ex SubUnit::FormFactorAmplitude(refPoint r, ParameterList&  betas, ParameterList
                                     }
     else if (varForm == XVAR)       {        
                                        betas[beta]=0;
-                                       for (auto& p:xparameters) params[p]=0;
-                                       return beta*FormFactorAmplitudeExpressions[r];
+                                       for (auto& p:terms()->xparameters) params[p]=0;
+                                       return beta*terms()->FormFactorAmplitudeExpressions[r];
                                     }
     else if (varForm == QVAR)       
                                     {
                                        betas[beta]=0;
-                                       for (auto& p:parameters) params[p]=0;
-                                       return beta*FormFactorAmplitudeExpressions[r].subs( expand );
+                                       for (auto& p:terms()->parameters) params[p]=0;
+                                       return beta*terms()->ExpandedFormFactorAmplitude(r);
                                     }
     else if (varForm == BETA)       {
                                        betas[beta]=0;
@@ -96,7 +96,7 @@ ex SubUnit::FormFactorAmplitude(refPoint r, ParameterList&  betas, ParameterList
                                     {
                                        betas[beta]=0;
                                        symbol q=GLEX->getSymbol("q");
-                                       for (auto& p:parameters) params[p]=0;
+                                       for (auto& p:terms()->parameters) params[p]=0;
 
                                        return beta*(1-q*q*getSigmaMSDRef2Scat(r)/6);
                                     }
@@ -155,20 +155,20 @@ try{
 
     if (varForm == XVAR || varForm == QVAR)
       {
-         if (PhaseFactorExpressions.find(r1)==PhaseFactorExpressions.end()) 
+         if (terms()->PhaseFactorExpressions.find(r1)==terms()->PhaseFactorExpressions.end()) 
                              throw SEBException("Invalid reference point "+r1+" not found in PhaseFactorExpressions table");
 
-         if (PhaseFactorExpressions[r1].find(r2)==PhaseFactorExpressions[r1].end()) 
+         if (terms()->PhaseFactorExpressions[r1].find(r2)==terms()->PhaseFactorExpressions[r1].end()) 
                              throw SEBException("Invalid reference point "+r2+" not found in PhaseFactors table");
                              
       }
 
     if (varForm == GUINIER)
       {
-         if (sigmaMSDref2ref.find(r1)==sigmaMSDref2ref.end()) 
+         if (terms()->sigmaMSDref2ref.find(r1)==terms()->sigmaMSDref2ref.end()) 
                              throw SEBException("Invalid reference point "+r1+" not found in sigmaMSDref2ref table");
 
-         if (sigmaMSDref2ref[r1].find(r2)==sigmaMSDref2ref[r1].end()) 
+         if (terms()->sigmaMSDref2ref[r1].find(r2)==terms()->sigmaMSDref2ref[r1].end()) 
                              throw SEBException("Invalid reference point "+r2+" not found in sigmaMSDref2ref table");   
       }
 
@@ -179,18 +179,18 @@ try{
                                        return psi;
                                     }
     else if (varForm == XVAR)       {
-                                       for (auto& p:xparameters) params[p]=0;
-                                       return PhaseFactorExpressions[r1][r2];
+                                       for (auto& p:terms()->xparameters) params[p]=0;
+                                       return terms()->PhaseFactorExpressions[r1][r2];
                                     }
     else if( varForm == QVAR )      {
-                                       for (auto& p:parameters) params[p]=0;
-                                       return PhaseFactorExpressions[r1][r2].subs(expand);
+                                       for (auto& p:terms()->parameters) params[p]=0;
+                                       return terms()->ExpandedPhaseFactor(r1, r2);
                                     }
     else if (varForm == BETA)       return ex(1);
     else if (varForm == ONE)        return ex(1);
     else if (varForm == GUINIER)    
                                    {
-                                       for (auto& p:parameters) params[p]=0;
+                                       for (auto& p:terms()->parameters) params[p]=0;
                                    
                                        symbol q=GLEX->getSymbol("q");
                                        return ex(1)-q*q*getSigmaMSDRef2Ref(r1,r2)/6;
@@ -206,6 +206,36 @@ try{
 
 
 
+/* QVAR expressions are expanded the first time they are requested, and reused afterwards. Since all sub-units with
+   the same type and tag share terms with their prototype, each expression is expanded once per type and tag. */
+const ex& SubUnit::ExpandedFormFactor()
+{
+    if (!formFactorExpanded)
+      {
+        ExpandedFormFactorExpression = FormFactorExpression.subs(expand);
+        formFactorExpanded = true;
+      }
+    return ExpandedFormFactorExpression;
+}
+
+const ex& SubUnit::ExpandedFormFactorAmplitude(const refPoint& r)
+{
+    auto it = ExpandedFormFactorAmplitudeExpressions.find(r);
+    if (it == ExpandedFormFactorAmplitudeExpressions.end())
+        it = ExpandedFormFactorAmplitudeExpressions.insert( make_pair(r, FormFactorAmplitudeExpressions[r].subs(expand)) ).first;
+    return it->second;
+}
+
+const ex& SubUnit::ExpandedPhaseFactor(const refPoint& r1, const refPoint& r2)
+{
+    map<refPoint, ex>& row = ExpandedPhaseFactorExpressions[r1];
+    auto it = row.find(r2);
+    if (it == row.end())
+        it = row.insert( make_pair(r2, PhaseFactorExpressions[r1][r2].subs(expand)) ).first;
+    return it->second;
+}
+
+
 // In rare case we do not want to track which parameters the expressions depend on:
 ex SubUnit::FormFactor( int varForm)                            {  ParameterList pl; return FormFactor(pl, pl, varForm); }
 ex SubUnit::FormFactorAmplitude(refPoint r, int varForm)        {  ParameterList pl; return FormFactorAmplitude(r, pl, pl, varForm); }
@@ -216,10 +246,10 @@ ex SubUnit::PhaseFactor(refPoint r1, refPoint r2, int varForm)  {  ParameterList
 ex  SubUnit::getSigmaMSDRef2Scat(refPoint r)
  {
     if(hasAHash(r)) r = removeHashString(r);
-    if (sigmaMSDref2scat.find(r)==sigmaMSDref2scat.end()) 
+    if (terms()->sigmaMSDref2scat.find(r)==terms()->sigmaMSDref2scat.end()) 
                 throw SEBException("Invalid reference point "+r+" not found in sigmaMSDref2scat table", "SubUnit::getSigmaMSDRef2Scat()");
 
-    return sigmaMSDref2scat[r];
+    return terms()->sigmaMSDref2scat[r];
 }
 
 /* Returns the mean square distance between pairs of reference points */    
@@ -237,13 +267,13 @@ ex  SubUnit::getSigmaMSDRef2Ref(refPoint r1, refPoint r2 )
     if(hasAHash(r1)) r1 = removeHashString(r1);
     if(hasAHash(r2)) r2 = removeHashString(r2);
 
-    if (sigmaMSDref2ref.find(r1)==sigmaMSDref2ref.end()) 
+    if (terms()->sigmaMSDref2ref.find(r1)==terms()->sigmaMSDref2ref.end()) 
                              throw SEBException("Invalid reference point "+r1+" not found in PhaseFactors table", "SubUnit::getSigmaMSDRef2Ref()");
 
-    if (sigmaMSDref2ref[r1].find(r2)==sigmaMSDref2ref[r1].end()) 
+    if (terms()->sigmaMSDref2ref[r1].find(r2)==terms()->sigmaMSDref2ref[r1].end()) 
                              throw SEBException("Invalid reference point "+r2+" not found in PhaseFactors table", "SubUnit::getSigmaMSDRef2Ref()");                                 
 
-    return  sigmaMSDref2ref[r1][r2];
+    return  terms()->sigmaMSDref2ref[r1][r2];
 }
 
 
@@ -267,9 +297,9 @@ void SubUnit::ValidateDefinedTerms( )
    // Validate all Form factor amplitude expressions and the corresponding sigmaMSDref2scat expressions.
    for (auto const& r : refs)
       {
-           if (FormFactorAmplitudeExpressions.find(r) == FormFactorAmplitudeExpressions.end()) 
+           if (terms()->FormFactorAmplitudeExpressions.find(r) == terms()->FormFactorAmplitudeExpressions.end()) 
                   { isOK=false; cout << "WARNING: FormFactorAmplitude Expression missing for ref=" << r << "\n"; }
-           if (sigmaMSDref2scat.find(r) == sigmaMSDref2scat.end()) 
+           if (terms()->sigmaMSDref2scat.find(r) == terms()->sigmaMSDref2scat.end()) 
                    { isOK=false; cout << "WARNING: sigmaMSDref2scat missing for ref=" << r << "\n"; }
       }
       
@@ -281,21 +311,21 @@ void SubUnit::ValidateDefinedTerms( )
            if (r2<r1) continue;   // We only store alfabetically sorted, so eventually we will test the other version.
            if (r1==r2 && hasSpecificReference(r1))   // r1=r2 for specific references are = 1 by definition so these should not be stored
                 {
-                   if (   PhaseFactorExpressions.find(r1) != PhaseFactorExpressions.end()
-                      &&  PhaseFactorExpressions[r1].find(r2)!=PhaseFactorExpressions[r1].end())
+                   if (   terms()->PhaseFactorExpressions.find(r1) != terms()->PhaseFactorExpressions.end()
+                      &&  terms()->PhaseFactorExpressions[r1].find(r2)!=terms()->PhaseFactorExpressions[r1].end())
                            cout << "Warning: PhaseFactor for spefic reference points r1=r2=" << r1 << " is defined, but is not used since its unity for spby definition\n";
                    continue;
                 }
            
-           if (PhaseFactorExpressions.find(r1)==PhaseFactorExpressions.end()) 
+           if (terms()->PhaseFactorExpressions.find(r1)==terms()->PhaseFactorExpressions.end()) 
                               { isOK=false; cout << "WARNING: PhaseFactor expression missing for r1=" << r1 << endl; }
-           if (PhaseFactorExpressions[r1].find(r2)==PhaseFactorExpressions[r1].end()) 
+           if (terms()->PhaseFactorExpressions[r1].find(r2)==terms()->PhaseFactorExpressions[r1].end()) 
                               { isOK=false; cout << "WARNING: PhaseFactor expression missing for r1=" << r1 << "  r2=" << r2 << endl; }
   
-           if (sigmaMSDref2ref.find(r1)==sigmaMSDref2ref.end()) 
+           if (terms()->sigmaMSDref2ref.find(r1)==terms()->sigmaMSDref2ref.end()) 
                               { isOK=false; cout << "WARNING: sigmaMSDref2ref expression missing for r1=" << r1 << endl; }
   
-           if (sigmaMSDref2ref[r1].find(r2)==sigmaMSDref2ref[r1].end()) 
+           if (terms()->sigmaMSDref2ref[r1].find(r2)==terms()->sigmaMSDref2ref[r1].end()) 
                               { isOK=false; cout << "WARNING: sigmaMSDref2ref expression missing for r1=" << r1 << "  r2=" << r2 << endl; }
                                }
       
@@ -308,10 +338,10 @@ void SubUnit::ValidateDefinedTerms( )
 // scattering expressions involves numerical integrals.
 bool SubUnit::ValidateFunctionSymbolically(ex& F, ex& SMSD, bool FormFactor, ex Fsymb, ParameterList pl)
 {
-   cout << Fsymb << "=" << F.subs(expand) << endl;
+   cout << Fsymb << "=" << F.subs(terms()->expand) << endl;
    
    symbol q = GLEX->getSymbol("q");
-   ex Fe = series_to_poly(F.subs(expand).series( q==0, 3));
+   ex Fe = series_to_poly(F.subs(terms()->expand).series( q==0, 3));
 
    ex c0 =    Fe.coeff(q,0);   // Should be 1
    ex c1 =    Fe.coeff(q,1);   // Should be 0
@@ -369,7 +399,7 @@ void SubUnit::ValidateSymbolically(ParameterList pl )
    bool isOK=true;
 
    // Valdate Form factor normalization and Rg^2 expression.
-   isOK = isOK && ValidateFunctionSymbolically( FormFactorExpression, RadiusOfGyration2, true, GLEX->getSymbol("F", tag) , pl);
+   isOK = isOK && ValidateFunctionSymbolically( terms()->FormFactorExpression, terms()->RadiusOfGyration2, true, GLEX->getSymbol("F", tag) , pl);
 
    ReferencePointSet refs;       
    for (auto const& r : refsSpecific)
@@ -386,7 +416,7 @@ void SubUnit::ValidateSymbolically(ParameterList pl )
    // Validate all Form factor amplitude expressions and the corresponding sigmaMSDref2scat expressions.
    for (auto const& r : refs)
       {
-           isOK = ValidateFunctionSymbolically( FormFactorAmplitudeExpressions[r], sigmaMSDref2scat[r], false, GLEX->getSymbol("A", tag, r) ,pl) && isOK;
+           isOK = ValidateFunctionSymbolically( terms()->FormFactorAmplitudeExpressions[r], terms()->sigmaMSDref2scat[r], false, GLEX->getSymbol("A", tag, r) ,pl) && isOK;
       }
       
    // Validate all phase factor expressions and the corresponding sigmaMSDref2ref expressions.
@@ -397,7 +427,7 @@ void SubUnit::ValidateSymbolically(ParameterList pl )
            if (r1==r2 && hasSpecificReference(r1))   // r1=r2 for specific references are = 1 by definition so these should not be stored
                    continue;
                      
-           isOK = ValidateFunctionSymbolically( PhaseFactorExpressions[r1][r2], sigmaMSDref2ref[r1][r2], false, GLEX->getSymbol("Psi", tag, r1,r2) , pl)  && isOK;
+           isOK = ValidateFunctionSymbolically( terms()->PhaseFactorExpressions[r1][r2], terms()->sigmaMSDref2ref[r1][r2], false, GLEX->getSymbol("Psi", tag, r1,r2) , pl)  && isOK;
       }
       
      if (!isOK) cout << "WARNING issues were found, please manually check the code is correct\n\n!";
@@ -447,12 +477,38 @@ void SubUnit::ValidateGraph(ex Fex, ex sigmaR2ex, bool FormFactor, vector<double
                   else cout << "GUINIER tests OK for " << filename << "\n";
  }
 
+ex SubUnit::getValidationTerm(char kind, refPoint r1, refPoint r2, ParameterList &pl, ex& smsd)
+{
+   if (kind=='F')
+     {
+        smsd = terms()->RadiusOfGyration2.subs(pl);
+        return terms()->FormFactorExpression.subs(terms()->expand).subs(pl);
+     }
+
+   if (kind=='A')
+     {
+        if (!hasAmplitudeRef(r1)) throw SEBException("Refpoint "+r1+" not valid for sub-unit form factor amplitude", "SubUnit::getValidationTerm('A', "+r1+")");
+        smsd = terms()->sigmaMSDref2scat[r1].subs(pl);
+        return terms()->FormFactorAmplitudeExpressions[r1].subs(terms()->expand).subs(pl);
+     }
+
+   if (kind=='P')
+     {
+        if (r2<r1) swap(r1, r2);     // Phase factors are stored alphabetically sorted.
+        if (!hasPhaseFactorRefs(r1,r2)) throw SEBException("Refpoints "+r1+" and "+r2+" not valid for sub-unit phase factor", "SubUnit::getValidationTerm('P', "+r1+", "+r2+")");
+        smsd = terms()->sigmaMSDref2ref[r1][r2].subs(pl);
+        return terms()->PhaseFactorExpressions[r1][r2].subs(terms()->expand).subs(pl);
+     }
+
+   throw SEBException(string("Unknown kind of scattering term ")+kind, "SubUnit::getValidationTerm");
+}
+
 // Saves a graph of all scattering expressions for the given parameters and qvec.
 // The graphs can be compared to output from sampling or e.g. mathematica derived expressions.
 void SubUnit::ValidateGraphically(ParameterList pl, vector<double> qvec, string base )
 {
    bool isOK=true;
-   ValidateGraph(FormFactorExpression.subs(expand).subs(pl), RadiusOfGyration2.subs(pl).evalf(), true, qvec, base+string("_FormFactor_"));
+   ValidateGraph(terms()->FormFactorExpression.subs(terms()->expand).subs(pl), terms()->RadiusOfGyration2.subs(pl).evalf(), true, qvec, base+string("_FormFactor_"));
 
    ReferencePointSet refs;       
    for (auto const& r : refsSpecific)
@@ -469,7 +525,7 @@ void SubUnit::ValidateGraphically(ParameterList pl, vector<double> qvec, string
    // Validate all Form factor amplitude expressions and the corresponding sigmaMSDref2scat expressions.
    for (auto const& r : refs)
       {
-           ValidateGraph(FormFactorAmplitudeExpressions[r].subs(expand).subs(pl), sigmaMSDref2scat[r].subs(pl).evalf(), false, qvec, base+string("_FormFactorAmplitude_")+r+"_");               
+           ValidateGraph(terms()->FormFactorAmplitudeExpressions[r].subs(terms()->expand).subs(pl), terms()->sigmaMSDref2scat[r].subs(pl).evalf(), false, qvec, base+string("_FormFactorAmplitude_")+r+"_");               
       }
       
    // Validate all phase factor expressions and the corresponding sigmaMSDref2ref expressions.
@@ -480,7 +536,7 @@ void SubUnit::ValidateGraphically(ParameterList pl, vector<double> qvec, string
            if (r1==r2 && hasSpecificReference(r1))   // r1=r2 for specific references are = 1 by definition so these should not be stored
                    continue;
 
-           ValidateGraph(PhaseFactorExpressions[r1][r2].subs(expand).subs(pl), sigmaMSDref2ref[r1][r2].subs(pl).evalf(), false, qvec, base+string("PhaseFactor_")+r1+"_"+r2+"_");
+           ValidateGraph(terms()->PhaseFactorExpressions[r1][r2].subs(terms()->expand).subs(pl), terms()->sigmaMSDref2ref[r1][r2].subs(pl).evalf(), false, qvec, base+string("PhaseFactor_")+r1+"_"+r2+"_");
       }
       
       if (!isOK) cout << "WARNING issues were found, please manually check the code is correct\n\n!";
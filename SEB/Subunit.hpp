@@ -103,6 +103,30 @@ class SubUnit : public ABSSubUnit
     map<refPoint, ex> sigmaMSDref2scat;                      // sigma_ref <R^2_ref,scat>       mean-square distance between specified reference point and all scatterers.
     map<refPoint, map<refPoint, ex>> sigmaMSDref2ref;        // sigma_ref,ref <R^2_ref,ref>    mean-square distance between specified reference points
 
+    /* Scattering expressions expanded with explicit structural parameters (QVAR), generated when first needed. */
+    ex ExpandedFormFactorExpression;
+    bool formFactorExpanded = false;
+    map<refPoint, ex> ExpandedFormFactorAmplitudeExpressions;
+    map<refPoint, map<refPoint, ex>> ExpandedPhaseFactorExpressions;
+
+    /* Sub-units with the same type and tag have identical scattering expressions. World passes the first sub-unit
+       initialized with a given type and tag as a prototype to the following ones, which then share the expressions
+       of the prototype rather than generating their own, and only keep their own name and reference points.  */
+    SubUnit* prototype = nullptr;
+    bool sharesTerms = false;
+
+    /* Called by Init once reference points are defined. Returns true if the sub-unit shares the scattering
+       expressions of a prototype, in which case Init should not generate them. */
+    bool SharePrototype() { sharesTerms = prototype != nullptr; return sharesTerms; }
+
+    /* The sub-unit holding the scattering expressions, either the prototype or this sub-unit. */
+    SubUnit* terms() { return sharesTerms ? prototype : this; }
+
+    /* QVAR expressions, expanded once and then reused. */
+    const ex& ExpandedFormFactor();
+    const ex& ExpandedFormFactorAmplitude(const refPoint& r);
+    const ex& ExpandedPhaseFactor(const refPoint& r1, const refPoint& r2);
+
     public:
     
     /*Constructor generating an SubUnit. The user constructs no-name sub-unit pointers, but it is world that 
@@ -138,6 +162,9 @@ class SubUnit : public ABSSubUnit
     // returns the type of a derived sub-unit instance.
     int getSubunitType() { return stype; }
 
+    // Sets the sub-unit with same type and tag that this sub-unit can share scattering expressions with. Must be called before Init.
+    void setPrototype(SubUnit* p) { prototype = p; }
+
     /*Returns the scattering length of the sub unit as the greek letter beta with the sub units tag as an index*/
     ex getBeta(){
         return GLEX->getSymbol("beta", tag);
@@ -157,7 +184,7 @@ class SubUnit : public ABSSubUnit
 
 
     /* Returns the radius of gyration of a sub unit. This always uses explicit structural parameters. */
-    ex virtual getRadiusOfGyration2() { return RadiusOfGyration2; }
+    ex virtual getRadiusOfGyration2() { return terms()->RadiusOfGyration2; }
 
     // Returns sigma <R^2> between the reference point and all scatterers in th
     ex  virtual getSigmaMSDRef2Scat(refPoint r);
@@ -250,7 +277,7 @@ class SubUnit : public ABSSubUnit
      
     bool ValidateFormFactorFile(ParameterList &pl, string filename, double tolerance=1e-4)
      {
-         return ValidateExpressionFile( FormFactorExpression.subs(expand).subs(pl), RadiusOfGyration2.subs(pl), filename, true, "FormFactor" , tolerance);
+         return ValidateExpressionFile( terms()->FormFactorExpression.subs(terms()->expand).subs(pl), terms()->RadiusOfGyration2.subs(pl), filename, true, "FormFactor" , tolerance);
      }
 
 
@@ -258,16 +285,21 @@ class SubUnit : public ABSSubUnit
      {
          if (!hasAmplitudeRef(r))
               throw SEBException("Refpoint "+r+" not valid for sub-unit form factor","ValidateFormFactorAmplitudeFile(refPoint r, ParameterList &pl, string filename, double tolerance=1e-4)");
-         return ValidateExpressionFile( FormFactorAmplitudeExpressions[r].subs(expand).subs(pl), sigmaMSDref2scat[r].subs(pl), filename, false, "FormFactorAmplitude["+r+"]", tolerance);
+         return ValidateExpressionFile( terms()->FormFactorAmplitudeExpressions[r].subs(terms()->expand).subs(pl), terms()->sigmaMSDref2scat[r].subs(pl), filename, false, "FormFactorAmplitude["+r+"]", tolerance);
      }
 
     bool ValidatePhaseFactorFile(refPoint r1, refPoint r2,ParameterList &pl, string filename, double tolerance=1e-4)
      {
          if (!hasPhaseFactorRefs(r1,r2))
               throw SEBException("Refpoints "+r1+" and "+r2+" not valid for sub-unit phase factor","bool ValidatePhaseFactorFile(refPoint r1, refPoint r2,ParameterList &pl, string filename, double tolerance=1e-4)");
-         return ValidateExpressionFile( PhaseFactorExpressions[r1][r2].subs(expand).subs(pl), sigmaMSDref2ref[r1][r2].subs(pl), filename, false, "PhaseFactor["+r1+"]["+r2+"]", tolerance);
+         return ValidateExpressionFile( terms()->PhaseFactorExpressions[r1][r2].subs(terms()->expand).subs(pl), terms()->sigmaMSDref2ref[r1][r2].subs(pl), filename, false, "PhaseFactor["+r1+"]["+r2+"]", tolerance);
      }
 
+    /* The term compared by the methods above, kind is 'F' for the form factor, 'A' for the form factor amplitude relative to r1,
+       or 'P' for the phase factor between r1 and r2. Symbols are expanded and pl is inserted, and smsd is set to the corresponding
+       Rg^2 or sigma<R^2>. Throws if the term is not defined for this sub-unit. */
+    ex getValidationTerm(char kind, refPoint r1, refPoint r2, ParameterList &pl, ex& smsd);
+
 
     /* Sets the reference point name */
     void setReferencePointName( refPoint ref ){   // WHAT DOES THIS DO??
@@ -337,17 +369,17 @@ class SubUnit : public ABSSubUnit
     // Tests that form factor amplitude terms exists for refpoint r  
     bool hasAmplitudeRef(refPoint r)
       {
-          return FormFactorAmplitudeExpressions.find(r) != FormFactorAmplitudeExpressions.end()
-              && sigmaMSDref2scat.find(r) != sigmaMSDref2scat.end();
+          return terms()->FormFactorAmplitudeExpressions.find(r) != terms()->FormFactorAmplitudeExpressions.end()
+              && terms()->sigmaMSDref2scat.find(r) != terms()->sigmaMSDref2scat.end();
       }
       
     // Tests that phase factor terms exists for refpoint r  
    bool hasPhaseFactorRefs(refPoint r1, refPoint r2)
       {
-         return PhaseFactorExpressions.find(r1) != PhaseFactorExpressions.end()
-            &&  PhaseFactorExpressions[r1].find(r2)!=PhaseFactorExpressions[r1].end()
-            &&  sigmaMSDref2ref.find(r1)!=sigmaMSDref2ref.end()
-            &&  sigmaMSDref2ref[r1].find(r2)!=sigmaMSDref2ref[r1].end();
+         return terms()->PhaseFactorExpressions.find(r1) != terms()->PhaseFactorExpressions.end()
+            &&  terms()->PhaseFactorExpressions[r1].find(r2)!=terms()->PhaseFactorExpressions[r1].end()
+            &&  terms()->sigmaMSDref2ref.find(r1)!=terms()->sigmaMSDref2ref.end()
+            &&  terms()->sigmaMSDref2ref[r1].find(r2)!=terms()->sigmaMSDref2ref[r1].end();
       }
 
 
@@ -7,19 +7,26 @@
 #ifndef INCLUDE_GUARD_CREATESUBUNIT
 #define INCLUDE_GUARD_CREATESUBUNIT
 
-SubUnit*  CreateSubunit(string subtype)
+// Creates a sub-unit of type T, in the pool if one is given.
+template<class T>
+SubUnit* NewSubunit(Pool* pool)
 {
-        if (subtype == "Point")               return new Point();
-   else if (subtype == "GaussianLoop")        return new GaussianLoop();
-   else if (subtype == "GaussianPolymer")     return new GaussianPolymer();
-   else if (subtype == "ThinRod")             return new ThinRod();
-   else if (subtype == "ThinCircle")          return new ThinCircle();
-   else if (subtype == "ThinDisk")            return new ThinDisk();
-   else if (subtype == "ThinSphericalShell")  return new ThinSphericalShell();
-   else if (subtype == "SolidSphere")         return new SolidSphere();
-   else if (subtype == "SolidSphericalShell") return new SolidSphericalShell();
-   else if (subtype == "SolidCylinder")       return new SolidCylinder();
-   else if (subtype == "SymbolicSubunit")     return new SymbolicSubunit();
+   return pool ? pool->Create<T>() : new T();
+}
+
+SubUnit*  CreateSubunit(string subtype, Pool* pool = nullptr)
+{
+        if (subtype == "Point")               return NewSubunit<Point>(pool);
+   else if (subtype == "GaussianLoop")        return NewSubunit<GaussianLoop>(pool);
+   else if (subtype == "GaussianPolymer")     return NewSubunit<GaussianPolymer>(pool);
+   else if (subtype == "ThinRod")             return NewSubunit<ThinRod>(pool);
+   else if (subtype == "ThinCircle")          return NewSubunit<ThinCircle>(pool);
+   else if (subtype == "ThinDisk")            return NewSubunit<ThinDisk>(pool);
+   else if (subtype == "ThinSphericalShell")  return NewSubunit<ThinSphericalShell>(pool);
+   else if (subtype == "SolidSphere")         return NewSubunit<SolidSphere>(pool);
+   else if (subtype == "SolidSphericalShell") return NewSubunit<SolidSphericalShell>(pool);
+   else if (subtype == "SolidCylinder")       return NewSubunit<SolidCylinder>(pool);
+   else if (subtype == "SymbolicSubunit")     return NewSubunit<SymbolicSubunit>(pool);
    else 
       throw SEBException("Unknown sub-unit type "+subtype,"Create");
 }
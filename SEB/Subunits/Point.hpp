@@ -39,6 +39,9 @@ class Point : public SubUnit{
         // specific reference points for a polymer
         setReferencePointName("point");
 
+        // Sub-units with the same type and tag share the scattering expressions below.
+        if (SharePrototype()) return;
+
         // ========================================================================================
         // Scattering expressions
         
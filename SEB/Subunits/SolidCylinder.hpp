@@ -49,6 +49,9 @@ class SolidCylinder : public SubUnit {
         setDistReferencePointType("ends");
         setDistReferencePointType("surface");
 
+        // Sub-units with the same type and tag share the scattering expressions below.
+        if (SharePrototype()) return;
+
         // ========================================================================================
         // Define symbols
         symbol q    = GLEX->getSymbol("q");
@@ -46,6 +46,9 @@ class SolidSphere : public SubUnit {
         // distributed reference points for a sphere        
         setDistReferencePointType("surface");
 
+        // Sub-units with the same type and tag share the scattering expressions below.
+        if (SharePrototype()) return;
+
         // ========================================================================================
         // Define symbols
         symbol q    = GLEX->getSymbol("q");
@@ -48,6 +48,9 @@ class SolidSphericalShell : public SubUnit {
         setDistReferencePointType("surfaceo");
         setDistReferencePointType("surfacei");
 
+        // Sub-units with the same type and tag share the scattering expressions below.
+        if (SharePrototype()) return;
+
         // ========================================================================================
         // Define symbols
         symbol q    = GLEX->getSymbol("q");
@@ -43,6 +43,9 @@ class ThinCircle : public SubUnit {
         // distributed reference points for a Circle        
         setDistReferencePointType("contour");
 
+        // Sub-units with the same type and tag share the scattering expressions below.
+        if (SharePrototype()) return;
+
         // Define symbols
         symbol q    = GLEX->getSymbol("q");
         symbol x    = GLEX->getSymbol("x", n); 
@@ -44,6 +44,9 @@ class ThinDisk : public SubUnit {
         setDistReferencePointType("surface");
         setDistReferencePointType("rim");
 
+        // Sub-units with the same type and tag share the scattering expressions below.
+        if (SharePrototype()) return;
+
         // Define symbols
         symbol q    = GLEX->getSymbol("q");
         symbol x    = GLEX->getSymbol("x", n); 
@@ -50,6 +50,9 @@ class ThinRod : public SubUnit{
         // distributed reference points for a polymer
         setDistReferencePointType("contour");
 
+        // Sub-units with the same type and tag share the scattering expressions below.
+        if (SharePrototype()) return;
+
          
         // ========================================================================================
         // Define symbols via GLEX interface
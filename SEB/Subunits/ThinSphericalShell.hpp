@@ -43,6 +43,9 @@ class ThinSphericalShell : public SubUnit {
         // distributed reference points for a ThinSphericalShell        
         setDistReferencePointType("surface");
 
+        // Sub-units with the same type and tag share the scattering expressions below.
+        if (SharePrototype()) return;
+
         // ========================================================================================
         // Define symbols
         symbol q    = GLEX->getSymbol("q");
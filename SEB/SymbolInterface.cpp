@@ -3,17 +3,19 @@
 using namespace GiNaC;
 using namespace std;
 
-/*Resets Symbol interface*/
-SymbolInterface* SymbolInterface::myInstance = 0;
-
-/*In first call to instance, generate symbol interface class*/
+/*In first call to instance, generate symbol interface class. Initialization of a static local is thread safe.*/
 SymbolInterface* SymbolInterface::instance(){
-    if( !myInstance ){
-        myInstance = new SymbolInterface();
-    }
+    static SymbolInterface* myInstance = new SymbolInterface();
     return myInstance;
 }
 
+/*The process wide lock serializing access to GiNaC*/
+recursive_mutex& GiNaCMutex()
+{
+    static recursive_mutex m;
+    return m;
+}
+
 /*
     Replaces all occurances with the from string to the to string in str.
     PROBLEM: we need case insensitive replace.
@@ -122,6 +124,7 @@ const symbol& SymbolInterface::get( const string& s ){
 // Store lowercase name as key to retrieve symbol
     string ss(s);  //transform(ss.begin(), ss.end(), ss.begin(), ::tolower);
 
+    lock_guard<recursive_mutex> lock(directoryMutex);
     auto it = symbolDirectory.find( ss );
     if( it != symbolDirectory.end()) return it -> second; 
                                 else return symbolDirectory.insert( make_pair( ss , symbol(s,string2latex(s)) )).first->second;
@@ -177,6 +180,7 @@ symtab SymbolInterface::getSymbolTable()
 {
     symtab table;
     
+    lock_guard<recursive_mutex> lock(directoryMutex);
     for (auto const& x : symbolDirectory)
          table[x.first]=x.second;
 
@@ -218,5 +222,8 @@ string to_string(ex e)
     return tmp;
 }
 
-
-
+size_t SymbolInterface::size()
+{
+    lock_guard<recursive_mutex> lock(directoryMutex);
+    return symbolDirectory.size();
+}
@@ -7,6 +7,7 @@
 // included dependencies
 
 #include <sstream>
+#include <mutex>
 #include <ginac/ginac.h>
 #include "Exceptions.hpp"
 
@@ -14,6 +15,26 @@
 using namespace GiNaC;
 using namespace std;
 
+/*
+    GiNaC is not thread safe: expressions share reference counted objects (symbols, and small numbers)
+    that are updated without synchronization. When several threads work with SEB (e.g. one World per thread),
+    every thread must hold a GiNaCLock while it creates, copies, derives or destroys expressions.
+    Compiled numerical evaluation (Evaluator::Compute) does not involve GiNaC and needs no lock.
+
+    The lock is recursive. Only a few entry points take it themselves: the World constructor and destructor,
+    World::Derive, World::Complexity, Polydispersity averages, Simulator and the parts of Evaluator that touch
+    expressions. All other World methods, e.g. Add, Link, FormFactor, FormFactorAmplitude, PhaseFactor and
+    Evaluate, do not. Hence with several threads, every thread must hold a GiNaCLock around all its calls to
+    World, except Evaluator::Compute, as in Examples/Concurrency.cpp. Single threaded programs never have to worry about it.
+*/
+recursive_mutex& GiNaCMutex();
+
+class GiNaCLock : public unique_lock<recursive_mutex>
+{
+public:
+    GiNaCLock() : unique_lock<recursive_mutex>(GiNaCMutex()) {}
+};
+
 // Helpers to convert GiNaC expressions to string representation
 
 string to_string_cform(ex);
@@ -42,11 +63,16 @@ string to_string(ex);
     \beta or \Psi are part of the name.
 */
 
-/*Symbol interface is a singleton that makes sure that a symbol is unique*/
+/*
+   Symbol interface makes sure that a symbol is unique. By default all worlds share the
+   symbol interface returned by instance(), but a World can also own a private symbol interface,
+   such that worlds on different threads do not share any symbols.
+   Lookups are synchronized, hence the shared symbol interface can be used from several threads.
+*/
 class SymbolInterface{
     private:
-    static SymbolInterface* myInstance;
     map<string, symbol> symbolDirectory;
+    recursive_mutex directoryMutex;
 
 // What is this used for?    
 //    map<pair<string, string>, symbol> latexSymbolDirectory;
@@ -72,6 +98,8 @@ class SymbolInterface{
      /*Symbol interface constructor*/
     SymbolInterface(){ }
     ~SymbolInterface(){};
+
+    // The symbol interface shared by all worlds.
     static SymbolInterface* instance();
 
     // From a string, return the corresponding symbol. This is required to ensure symbol object is unique for a given string.
@@ -91,6 +119,9 @@ class SymbolInterface{
 
     symtab getSymbolTable();
 
+    // Number of symbols created.
+    size_t size();
+
 //    template <typename... Args>
 //    const symbol& getIndex( std::string s, std::string latex , Args... indices);
         
@@ -21,14 +21,16 @@ try{
     if (hasName(name))                               throw SEBException("Name "+name+" already exists in the world");
     if (!testSubunitPointer(sub))                    throw SEBException("Supplied subUnit pointer does not point a sub-unit.");
 
-    sub->Init(name, tag, GLEX);
+    InitSubunit(sub, name, tag);
 
     totalNumberofGraphs++;                // Every add creates a new graph since the sub-unit is not connected to anything.
     list<subName> subList;
     subList.push_back(name);
     subGraphs.insert(pair<GraphID, list<subName>>(totalNumberofGraphs, subList));
+    graphOfName[name] = totalNumberofGraphs;
     nameCatalog.insert(pair<subName, SubUnit *>(name, sub));
     typeCatalog.insert(pair<subName, int>(name, sub->getType()));
+    RegisterPrototype(sub, name, tag);
 
     return totalNumberofGraphs;
 }
@@ -39,10 +41,27 @@ catch (SEBException& e)
 }
 }
 
+/* Initializes a sub-unit, sharing scattering expressions with the prototype for its type and tag if there is one. */
+void World::InitSubunit(SubUnit *sub, subName name, string tag)
+{
+    auto it = prototypes.find( make_pair(sub->getSubunitType(), tag.empty() ? name : tag) );
+
+    sub->setPrototype( it == prototypes.end() ? nullptr : it->second );
+    sub->Init(name, tag, GLEX);
+}
+
+/* The first sub-unit added to the world with a given type and tag becomes the prototype for that type and tag.
+   Only called once the sub-unit is owned by the world, so a failed Link never leaves a prototype behind. */
+void World::RegisterPrototype(SubUnit *sub, subName name, string tag)
+{
+    auto key = make_pair(sub->getSubunitType(), tag.empty() ? name : tag);
+    if (prototypes.find(key) == prototypes.end()) prototypes[key] = sub;
+}
+
 // Helper
 GraphID World::Add(string subtype, subName name, string tag)
 {
-   return Add(CreateSubunit(subtype), name, tag);
+   return Add(CreateSubunit(subtype, &pool), name, tag);
 }
 
 
@@ -67,12 +86,13 @@ try{
     if (!testGraphID(gid))                throw SEBException("Bad graphid:"+to_string(gid) );
     if (hasName(name))                    throw SEBException("Name "+name+" already exists in the world");
 
-    Structure *struc = new Structure(name, gid, GLEX);
+    Structure *struc = Create<Structure>(name, gid, GLEX);
     totalNumberofGraphs++;
     
     list<structName> struccontainer;
     struccontainer.push_back(name);
     subGraphs.insert(pair<GraphID, list<structName>>(totalNumberofGraphs, struccontainer));
+    graphOfName[name] = totalNumberofGraphs;
     
     nameCatalog.insert(pair<string, ABSSubUnit *>(name, struc));
     typeCatalog.insert(pair<string, int>(name, struc->getType()));
@@ -128,7 +148,7 @@ try{
     if (!hasName(oldname))                               throw SEBException("Name "+oldname+" does not exist in the world");
 
 // Initialize sub-unit, this also sets up the known reference points for this type.
-    sub->Init(newname, tag,  GLEX);
+    InitSubunit(sub, newname, tag);
 
 // Test that both reference points are good.
     string newref = getReferenceBase(newr); // extract refbase   from e.g. name.refbase#mypoint
@@ -161,7 +181,10 @@ try{
 
     nameCatalog.insert(pair<string, ABSSubUnit *>(newname, sub));
     typeCatalog.insert(pair<string, int>(newname, sub->getType()));
+    RegisterPrototype(sub, newname, tag);
     subGraphs.find(gId)->second.push_back(newname);
+    graphOfName[newname] = gId;
+    linkLog.push_back(gId);
     links.push_back(generateLink(oldr, newr));
 
     return gId;
@@ -177,7 +200,7 @@ catch (SEBException& e)
 // helper
 GraphID World::Link(string subtype, refPoint newr, refPoint oldr, string tag)
 {
-   return Link(CreateSubunit(subtype), newr, oldr, tag);
+   return Link(CreateSubunit(subtype, &pool), newr, oldr, tag);
 }
 
 /*
@@ -235,10 +258,12 @@ try{
             getSubunit(oldsubname)->addRandomDistributedReferencePoint(refbase, random);    // add if not already exists.;
         }
         
-    Structure *struc = new Structure(newname, gid, GLEX);
+    Structure *struc = Create<Structure>(newname, gid, GLEX);
 
     GraphID oldgraphID = getGraphID(oldname);
     subGraphs.find(oldgraphID)->second.push_back(newname);
+    graphOfName[newname] = oldgraphID;
+    linkLog.push_back(oldgraphID);
     
     nameCatalog.insert(pair<string, Structure *>(newname, struc));
     typeCatalog.insert(pair<string, int>(newname, struc->getType()));
@@ -409,6 +434,7 @@ catch (SEBException& e)
 ReferencePointList World::findpath(string name1, string name2, bool check)
 {
 try{
+    TraceSpan span(*this, "findpath", name1, -1, &name1, &name2);
 
     if(prefix(name1) != prefix(name2))    throw SEBException("Both search paths should start in the same structure.");
     if (check) testPathSyntax(name1);
@@ -419,6 +445,7 @@ try{
         
     if (prefix(name1)==prefix(name2))       // Returns an empty path.
        {
+             if (collectStats) CountPathSearch(0);
              ReferencePointList Path;
              return Path;
        }
@@ -469,6 +496,7 @@ try{
                       || (!istargetref && prefix(next) == prefix(name2)) )  //   case of substructure / sub-unit target
                     {
                        if (reversesearch) path.reverse();                   // In case we were search from target to source reverse path.
+                       if (collectStats) CountPathSearch(VisitedAlready.size());
                        return path;                                         // and return it.
                     }
 
@@ -488,6 +516,83 @@ catch (SEBException& e)
 }
 
 
+/*  Path between two reference handles. The handles were validated by ref(), so checks are skipped. */
+ReferencePointList  World::Path( const RefHandle& r1, const RefHandle& r2, int depth)
+{
+try{
+    testHandle(r1);
+    testHandle(r2);
+    return Path(r1.path, r2.path, depth, false);
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("ReferencePointList  World::Path(RefHandle "+r1.path+", RefHandle "+r2.path+", int "+to_string(depth)+")");
+   throw;
+}
+}
+
+/*  Parses and validates a path once, e.g. "chain:star1:diblock1:polyB.end2" or "chain:star1", and stores the chain of names
+    and the reference point. */
+RefHandle World::ref(string path)
+{
+try{
+    if (path.empty())          throw SEBException("Empty path");
+    if (!hasName(prefix(path))) throw SEBException("Unknown name "+prefix(path)+" in world.");
+    testPathSyntax(path);
+
+    RefHandle h;
+    h.world = this;
+    h.path = path;
+
+    string rest = path;
+    while (hasAColon(rest))
+      {
+        h.names.push_back(prefix(rest));
+        rest = postfix(rest);
+      }
+    h.names.push_back(getName(rest));
+    if (hasAPeriod(rest)) h.reference = getReference(rest);
+
+    return h;
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("RefHandle World::ref(string path=\""+path+"\")");
+   throw;
+}
+}
+
+void World::testHandle(const RefHandle& h)
+{
+    if (h.world != this) throw SEBException("Reference handle \""+h.path+"\" does not belong to this world", "World::testHandle(..)");
+}
+
+
+/*  Finds paths for many pairs. Path searches only read the world, and can run concurrently, whereas the
+    scattering expressions are assembled from the paths afterwards, in the serial order, since GiNaC is not thread safe.
+*/
+vector<ReferencePointList> World::findpaths(const vector<pair<string, string>>& pairs, bool check)
+{
+    vector<ReferencePointList> paths(pairs.size());
+
+    const int minimumpairs = 32;   // Below this threads cost more than they gain.
+    if (parallelDerivation && pairs.size() >= minimumpairs)
+        ParallelTasks( pairs.size(), [&](int t) { paths[t] = findpath(pairs[t].first, pairs[t].second, check); } );
+    else
+        for (size_t t=0; t<pairs.size(); t++) paths[t] = findpath(pairs[t].first, pairs[t].second, check);
+
+    return paths;
+}
+
+// Counts a path search, which may run on any thread.
+void World::CountPathSearch(long visited)
+{
+    lock_guard<mutex> lock(statsMutex);
+    stats.findpathCalls++;
+    stats.visited += visited;
+}
+
+
 /*  Not used by SEB, but provides paths between pairs of reference points at a user specified depth. Thus path is specified at the
     same height as the two starting reference points.  */
 ReferencePointList  World::Path( refPoint r1, refPoint r2, int depth, bool doCheck)
@@ -573,7 +678,7 @@ try{
         testPathSyntax(r2);
       }
 
-    betas.clear(); params.clear();
+    ResetParameters();
 
     return GenerateRefToRef( r1, r2, depth, varForm );
 }
@@ -595,7 +700,7 @@ try{
    if (!hasAPeriod(ref))  throw SEBException("String \""+ref+"\" does not specify a reference point.");     
    if(isStructure(myself)) testPathSyntax(ref);
                           
-   betas.clear(); params.clear();
+   ResetParameters();
 
    return GenerateRefToAll( ref,  depth, varForm )/GenerateRefToAll( ref,  depth, BETA );
 }
@@ -616,7 +721,7 @@ try{
    if (!hasName(myself))   throw SEBException("Unknown name "+myself+" in world.");
    if (!hasAPeriod(ref))   throw SEBException("String \""+ref+"\" does not specify a reference point.");     
    if(isStructure(myself)) testPathSyntax(ref);
-   betas.clear(); params.clear();
+   ResetParameters();
    
    return GenerateRefToAll( ref,  depth, varForm );
 }
@@ -627,6 +732,97 @@ catch (SEBException& e)
 }
 }
 
+// Same front ends for reference handles, which have already been validated by ref()
+ex World::PhaseFactor( const RefHandle& r1, const RefHandle& r2, int depth, int varForm)
+{
+try{
+    testHandle(r1);
+    testHandle(r2);
+    if (r1.names.front() != r2.names.front())           throw SEBException("Both reference points should be in the same structure / reference point.");
+    if (!r1.isReferencePoint() || !r2.isReferencePoint()) throw SEBException("Handles do not specify reference points.");
+    if (depth<0)                                         throw SEBException("Depth can not be negative.");
+
+    ResetParameters();
+
+    return GenerateRefToRef( r1.path, r2.path, depth, varForm );
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::PhaseFactor(RefHandle r1=\""+r1.path+"\", RefHandle r2=\""+r2.path+"\", int depth="+to_string(depth)+"..)");
+   throw;
+}
+}
+
+ex World::FormFactorAmplitude( const RefHandle& ref, int depth , int varForm  )
+{
+try{
+   testHandle(ref);
+   if (depth<0)                 throw SEBException("Depth can not be negative.");
+   if (!ref.isReferencePoint()) throw SEBException("Handle \""+ref.path+"\" does not specify a reference point.");
+
+   ResetParameters();
+
+   return GenerateRefToAll( ref.path,  depth, varForm )/GenerateRefToAll( ref.path,  depth, BETA );
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::FormFactorAmplitude(RefHandle ref=\""+ref.path+"\",int depth="+to_string(depth)+", int varForm="+to_string(varForm)+")");
+   throw;
+}
+}
+
+ex World::FormFactorAmplitude_Unnormalized( const RefHandle& ref, int depth, int varForm)
+{
+try{
+   testHandle(ref);
+   if (depth<0)                 throw SEBException("Depth can not be negative.");
+   if (!ref.isReferencePoint()) throw SEBException("Handle \""+ref.path+"\" does not specify a reference point.");
+
+   ResetParameters();
+
+   return GenerateRefToAll( ref.path,  depth, varForm );
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::FormFactorAmplitude_Unnormalized( RefHandle ref=\""+ref.path+"\",int depth="+to_string(depth)+", int varForm="+to_string(varForm)+",..)");
+   throw;
+}
+}
+
+ex World::FormFactor( const RefHandle& name, int depth, int varForm )
+{
+try{
+   testHandle(name);
+   if (name.names.size() != 1 || name.isReferencePoint()) throw SEBException("Expected handle to a structure/sub-unit name got "+name.path);
+   if (depth<0)                                           throw SEBException("Depth can not be negative.");
+   ResetParameters();
+
+   return GenerateAllToAll( name.path, depth, varForm)/GenerateAllToAll( name.path, depth, BETA);
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("ex World::FormFactor( RefHandle \""+name.path+"\", depth="+to_string(depth)+",..)");
+   throw;
+}
+}
+
+ex World::FormFactor_Unnormalized( const RefHandle& name, int depth, int varForm)
+{
+try{
+   testHandle(name);
+   if (name.names.size() != 1 || name.isReferencePoint()) throw SEBException("Expected handle to a structure/sub-unit name got "+name.path);
+   if (depth<0)                                           throw SEBException("Depth can not be negative.");
+   ResetParameters();
+
+   return GenerateAllToAll( name.path, depth, varForm);
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("ex World::FormFactor_Unnormalized( RefHandle \""+name.path+"\", depth="+to_string(depth)+",..)");
+   throw;
+}
+}
+
 // User front end for generating form factors everything is weighed by beta factors and normalized by (sum beta)^2
 ex World::FormFactor( structName myself, int depth, int varForm )
 {
@@ -635,7 +831,7 @@ try{
    if (hasAPeriod(myself)) throw SEBException("Expected structure/sub-unit name got . in "+myself);
    if (!hasName(myself))   throw SEBException("Unknown structure/sub-unit "+myself);
    if (depth<0)            throw SEBException("Depth can not be negative.");
-   betas.clear(); params.clear();
+   ResetParameters();
 
    return GenerateAllToAll( myself, depth, varForm)/GenerateAllToAll( myself, depth, BETA);
 }
@@ -654,7 +850,7 @@ try{
    if (hasAPeriod(myself)) throw SEBException("Expected structure/sub-unit name got . in "+myself);
    if (!hasName(myself))   throw SEBException("Unknown structure/sub-unit "+myself);
    if (depth<0)            throw SEBException("Depth can not be negative.");
-   betas.clear(); params.clear();
+   ResetParameters();
  
    return GenerateAllToAll( myself, depth, varForm);
 }
@@ -774,11 +970,102 @@ ex World::Count(refPoint ref, int depth)
     return FormFactorAmplitude_Unnormalized(ref, depth, ONE);
 }
 
+ex World::SMSD_ref2scat( const RefHandle& ref, int depth)
+{
+    ex q=GLEX->getSymbol("q");
+    ex A = FormFactorAmplitude_Unnormalized( ref, depth, GUINIER ).expand();
+    return -6*A.coeff(q, 2)/A.coeff(q, 0);
+}
+
+ex World::SMSD_ref2ref( const RefHandle& r1, const RefHandle& r2, int depth  )
+{
+    ex q=GLEX->getSymbol("q");
+    return -6*PhaseFactor( r1, r2 , depth, GUINIER ).expand().coeff(q, 2);
+}
+
+ex World::Count(const RefHandle& ref, int depth)
+{
+    return FormFactorAmplitude_Unnormalized(ref, depth, ONE);
+}
+
 ex World::CountPairs( string name, int depth)
 {
     return FormFactor_Unnormalized(name, depth, ONE);
 }
 
+// The variants above for reference handles.
+ex World::PhaseFactorX( const RefHandle& r1, const RefHandle& r2, int depth)
+{
+    return PhaseFactor( r1, r2, depth, XVAR );
+}
+
+ex World::PhaseFactorGeneric( const RefHandle& r1, const RefHandle& r2, int depth)
+{
+    return PhaseFactor(r1, r2, depth, GENERIC);
+}
+
+ex World::FormFactorAmplitudeX( const RefHandle& ref, int depth)
+{
+   return FormFactorAmplitude(ref, depth, XVAR);
+}
+
+ex World::FormFactorAmplitudeGeneric( const RefHandle& ref, int depth)
+{
+   return FormFactorAmplitude(ref, depth, GENERIC);
+}
+
+ex World::FormFactorAmplitudeX_Unnormalized( const RefHandle& ref, int depth)
+{
+   return FormFactorAmplitude_Unnormalized(ref, depth, XVAR);
+}
+
+ex World::FormFactorAmplitudeGeneric_Unnormalized( const RefHandle& ref, int depth)
+{
+   return FormFactorAmplitude_Unnormalized(ref, depth, GENERIC);
+}
+
+ex World::FormFactorAmplitude_Normalization( const RefHandle& ref, int depth )
+{
+   return FormFactorAmplitude_Unnormalized(ref, depth, BETA);
+}
+
+ex World::FormFactorX( const RefHandle& name, int depth)
+{
+    return FormFactor(name, depth, XVAR);
+}
+
+ex World::FormFactorGeneric( const RefHandle& name, int depth)
+{
+    return FormFactor(name, depth, GENERIC);
+}
+
+ex World::FormFactorX_Unnormalized( const RefHandle& name, int depth)
+{
+    return FormFactor_Unnormalized(name, depth, XVAR);
+}
+
+ex World::FormFactorGeneric_Unnormalized( const RefHandle& name, int depth)
+{
+    return FormFactor_Unnormalized(name, depth, GENERIC);
+}
+
+ex World::FormFactor_Normalization( const RefHandle& name, int depth)
+{
+    return FormFactor_Unnormalized(name, depth, BETA);
+}
+
+ex World::RadiusOfGyration2( const RefHandle& name, int depth )
+{
+    ex q=GLEX->getSymbol("q");
+    ex F = FormFactor_Unnormalized( name, depth, GUINIER ).expand();
+    return -3*F.coeff(q, 2)/F.coeff(q, 0);
+}
+
+ex World::CountPairs( const RefHandle& name, int depth)
+{
+    return FormFactor_Unnormalized(name, depth, ONE);
+}
+
 
 
 
@@ -794,9 +1081,8 @@ bool World::doesSubgraphContainName(int gid, string n)
 {
    if (!testGraphID(gid))    throw SEBException("Bad graphid "+to_string(gid), "World::doesSubgraphContainName(GraphID ="+to_string(gid)+", string=\""+n+"\")");
 
-   for ( auto item : subGraphs.at(gid))
-      if (item == n) return true;
-   return false;
+   auto it = graphOfName.find(n);
+   return it != graphOfName.end() && it->second == gid;
 }
 
 
@@ -818,9 +1104,8 @@ GraphID World::getGraphID(string name)
 {
     if (hasAColon(name))  throw SEBException("The specified name contains a :", "World::getGraphID(string "+name+")");
 
-    for (auto itr : subGraphs)
-        for (auto itr2 : itr.second)
-            if (itr2 == name) return itr.first;
+    auto it = graphOfName.find(name);
+    if (it != graphOfName.end()) return it->second;
 
     throw SEBException("The specified name was not found in any sub-graph", "World::getGraphID(string "+name+")");
 }
@@ -910,6 +1195,37 @@ ParameterList World::getParams()
    return pl;
 }
        
+// Runs a derivation under the GiNaC lock, and collects the parameters of all expressions it derives separately,
+// leaving the parameters collected by the world untouched.
+World::Derivation World::Derive(const std::function<ex()>& derivation)
+{
+   GiNaCLock lock;
+   ParameterScope outer(*this);
+   bool wasDeriving = deriving;
+   deriving = true;
+
+   Derivation d;
+   try {
+       d.expression = derivation();
+   }
+   catch (...) {
+       deriving = wasDeriving;
+       throw;
+   }
+   deriving = wasDeriving;
+
+   d.parameters = getParams();
+   return d;
+}
+
+// Front ends start collecting the parameters of a new expression, except inside Derive.
+void World::ResetParameters()
+{
+   if (deriving) return;
+   betas.clear();
+   params.clear();
+}
+
 // Returns a copy of the parameter lists.
 ParameterList World::getParamsq()
 {
@@ -1023,6 +1339,18 @@ DoubleVector World::Evaluate(ex e, ParameterList& pl, DoubleVector& q)
    return I;
 } 
 
+vector<DoubleVector> World::Evaluate(const vector<ex>& exprs, ParameterList& pl, DoubleVector& q)
+try
+{
+   Evaluator ev(exprs);
+   return ev.Evaluate(pl, GLEX->getSymbol("q"), q);
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::Evaluate(vector<ex>, ParameterList&, DoubleVector&)");
+   throw;
+}
+
 DoubleVector World::Evaluate(ex e, ParameterList& pl, DoubleVector& q, string fname, string comment, string prefix)
 {
    DoubleVector I=Evaluate(e,pl,q);
@@ -1045,6 +1373,156 @@ DoubleVector World::Evaluate(ex e, ParameterList& pl, DoubleVector& q, string fn
 }
 
 
+void World::setPolydispersity(Polydispersity& pd, string str, int family, double width, int nodes)
+try
+{
+   pd.Add(GLEX->get(str), family, width, nodes);
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::setPolydispersity(Polydispersity&, "+str+", "+to_string(family)+", "+to_string(width)+", "+to_string(nodes)+")");
+   throw;
+}
+
+DoubleVector World::Evaluate(ex expr, ParameterList& pl, DoubleVector& q, Polydispersity& pd)
+try
+{
+   Evaluator ev(expr);
+   return pd.Average(ev, pl, GLEX->getSymbol("q"), q)[0];
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::Evaluate(ex, ParameterList&, DoubleVector&, Polydispersity&)");
+   throw;
+}
+
+void World::EvaluateDecoupling(ex F, ex A, ParameterList& pl, DoubleVector& q, Polydispersity& pd, DoubleVector& Favg, DoubleVector& A2avg)
+try
+{
+   DecouplingModel model(F, A, GLEX->getSymbol("q"));
+   model.Compute(pl, q, pd);
+
+   Favg  = model.getFormFactor();
+   A2avg = model.getAmplitudeSquared();
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::EvaluateDecoupling(ex, ex, ParameterList&, DoubleVector&, Polydispersity&, DoubleVector&, DoubleVector&)");
+   throw;
+}
+
+/*  Evaluating level by level, e.g. for a chain of stars of diblocks with depth 1, the chain form factor is derived in terms of
+    F, A and Psi of the stars, these are derived in terms of F, A and Psi of the diblocks and so on. Each distinct symbol
+    is evaluated once for all q values, and the values are passed on as lane variables to the level above. The size of the
+    expressions is thus the sum rather than the product of the number of terms at each level.
+*/
+DoubleVector World::EvaluateByLevels(string name, ParameterList& pl, DoubleVector& q, int depth)
+try
+{
+   if (depth<1) throw SEBException("Depth must be at least 1.");
+
+   LaneValues values;
+   return EvaluateLevel( FormFactor(name, depth), pl, q, depth, values );
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::EvaluateByLevels("+name+", ParameterList&, DoubleVector&, "+to_string(depth)+")");
+   throw;
+}
+
+DoubleVector World::EvaluateLevel(const ex& expr, ParameterList& pl, DoubleVector& q, int depth, LaneValues& values)
+{
+   Evaluator ev(expr);
+
+   for (auto& s : ev.Symbols())
+      {
+        auto it = genericTerms.find(s);
+        if (it == genericTerms.end() || values.count(s)) continue;
+
+        GenericTerm t = it->second;                                             // Copy, as deriving below adds more generic terms.
+        ex inner;
+        switch (t.kind)
+          {
+            case 'F': inner = FormFactor(t.name, depth); break;
+            case 'A': inner = FormFactorAmplitude(t.r1, depth); break;
+            case 'P': inner = PhaseFactor(t.r1, t.r2, depth); break;
+            case 'B': inner = FormFactorAmplitude_Normalization(getReferencePoints(t.name).front()); break;   // Sum of betas, without q dependence.
+          }
+
+        values[s] = EvaluateLevel(inner, pl, q, depth, values);
+      }
+
+   return ev.Evaluate(pl, GLEX->getSymbol("q"), q, values)[0];
+}
+
+AdaptiveGrid World::EvaluateAdaptive(ex expr, ParameterList& pl, double q1, double q2, double tolerance, int maxpoints)
+try
+{
+   Evaluator ev(expr);
+   ex Q=GLEX->getSymbol("q");
+
+   AdaptiveGrid grid;
+   grid.Sample( [&](const DoubleVector& qn) { return ev.Evaluate(pl, Q, qn)[0]; }, q1, q2, tolerance, maxpoints);
+   return grid;
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::EvaluateAdaptive(ex, ParameterList&, "+to_string(q1)+", "+to_string(q2)+", "+to_string(tolerance)+", "+to_string(maxpoints)+")");
+   throw;
+}
+
+DoubleVector World::EvaluateDecoupling(ex F, ex A, ParameterList& pl, DoubleVector& q, StructureFactor& S)
+try
+{
+   DecouplingModel model(F, A, GLEX->getSymbol("q"));
+   model.Compute(pl, q);
+   return model.Intensity(S);
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::EvaluateDecoupling(ex, ex, ParameterList&, DoubleVector&, StructureFactor&)");
+   throw;
+}
+
+DoubleVector World::EvaluateDecoupling(ex F, ex A, ParameterList& pl, DoubleVector& q, Polydispersity& pd, StructureFactor& S)
+try
+{
+   DecouplingModel model(F, A, GLEX->getSymbol("q"));
+   model.Compute(pl, q, pd);
+   return model.Intensity(S);
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::EvaluateDecoupling(ex, ex, ParameterList&, DoubleVector&, Polydispersity&, StructureFactor&)");
+   throw;
+}
+
+DoubleVector World::Evaluate(ex expr, ParameterList& pl, DoubleVector& q, Resolution& res)
+try
+{
+   Evaluator ev(expr);
+   ex Q=GLEX->getSymbol("q");
+   return res.Smear( [&](const DoubleVector& qn) { return ev.Evaluate(pl, Q, qn)[0]; }, q);
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::Evaluate(ex, ParameterList&, DoubleVector&, Resolution&)");
+   throw;
+}
+
+DoubleVector World::Evaluate(ex expr, ParameterList& pl, DoubleVector& q, Polydispersity& pd, Resolution& res)
+try
+{
+   Evaluator ev(expr);
+   ex Q=GLEX->getSymbol("q");
+   return res.Smear( [&](const DoubleVector& qn) { return pd.Average(ev, pl, Q, qn)[0]; }, q);
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("World::Evaluate(ex, ParameterList&, DoubleVector&, Polydispersity&, Resolution&)");
+   throw;
+}
+
 /*
 Prints out all nested structures in a structure using a directory format. 
 
@@ -1165,28 +1643,30 @@ void World::printList(ReferencePointList path, string prefix, string postfix)
 ex World::GenerateRefToRef( refPoint r1, refPoint r2, int depth, int varForm)
 {
     string myself=prefix(r1);
+    StatsScope scope(*this);
+    TraceSpan span(*this, "GenerateRefToRef", myself, depth, &r1, &r2);
 
     // If we have two paths to a reference point inside a structure:
     if (isStructure(myself))
       {
         // Trivial case
-        if(isLinked(r1, r2) || r1 == r2 ) return ex(1);
+        if(isLinked(r1, r2) || r1 == r2 ) return scope.Result(ex(1));
     
         // We are still in a structure, so return GENERIC expression for psi.
-        if(depth == 0) return getPsi( myself, postfix(r1), postfix(r2), varForm);
+        if(depth == 0) return scope.Result(getPsi( myself, postfix(r1), postfix(r2), varForm));
         
         // depth>0   hence we could have XX:YY... XX:ZZ...  or  XX:YY... XX:YY...  in the second case the yy-yo-yy path would be empty, so we have to handle thus case
         if (prefix(postfix(r1)) == prefix(postfix(r2)))   // XX:YY.. and XX:yy..
-               return GenerateRefToRef( postfix(r1) , postfix(r2), depth - 1, varForm);          
+               return scope.Result(GenerateRefToRef( postfix(r1) , postfix(r2), depth - 1, varForm));
          else
            {                                                                                    // The two points have different second prefix, hence the path will not be empty.
-               ReferencePointList  path = findpath(r1, r2, false);                              // Find path, don't check arguments.
-               return PhaseFactor(path, depth-1, myself, varForm);                            // Use helper to geneerate product of Psi terms.
+               ReferencePointList  path = scope.Timed(stats.pathsearch, [&]{ return findpath(r1, r2, false); });   // Find path, don't check arguments.
+               return scope.Result(PhaseFactor(path, depth-1, myself, varForm));              // Use helper to geneerate product of Psi terms.
          }
     }
     else
      if (isSubunit(myself))     // r1,r2 must have the form   r1=subunit.ref1  r2=subunitname.ref2      
-        return getSubunit(getName(r1))->PhaseFactor(getReference(r1), getReference(r2), betas, params,  varForm);  
+        return scope.Result(scope.Timed(stats.subunits, [&]{ return getSubunit(getName(r1))->PhaseFactor(getReference(r1), getReference(r2), betas, params,  varForm); }));
 
     throw SEBException("Internal error.",
                         "World::GenerateRefToRef( refPoint r1=\""+r1+"\", refPoint r2=\""+r2+"\", int depth="+to_string(depth)+", int varForm="+to_string(varForm)+")");
@@ -1248,18 +1728,30 @@ ex World::GenerateRefToRef( refPoint r1, refPoint r2, int depth, int varForm)
 ex World::GenerateRefToAll( refPoint ref, int depth, int varForm )
 {
    string myself=prefix(ref);
+   StatsScope scope(*this);
+   TraceSpan span(*this, "GenerateRefToAll", myself, depth, &ref);
    if(isStructure(myself))
     {
         // Depth 0 reached, but we are still in structure, so return a GENERIC expression.
-        if(depth == 0) return getFFA( myself, postfix(ref), varForm);
+        if(depth == 0) return scope.Result(getFFA( myself, postfix(ref), varForm));
 
-        ex A = 0;
         Structure *sptr = getStructure(myself);
         GraphID gid = sptr->getGraphID();
-        
-        for (auto child =subgraph_cbegin(gid) ; child!= subgraph_cend(gid) ; ++child)                          // Loop over all children
+
+        TermCache& cache = getTermCache( make_tuple(ref, depth, varForm), gid );                               // Terms of children already derived.
+        if (isUpToDate(cache, gid)) return scope.Result(cache.terms);                                          // No new children since last derivation.
+        vector<string> children( subgraph_cbegin(gid), subgraph_cend(gid) );
+        ParameterScope outer(*this);                                                                           // Collect parameters of the new terms separately.
+
+        vector<pair<string, string>> pairs;                                                                    // Find paths from reference point to the new children first.
+        for (size_t c=cache.children; c<children.size(); c++)
+            pairs.push_back( make_pair(ref, myself+":"+children[c]) );
+        vector<ReferencePointList> paths = scope.Timed(stats.pathsearch, [&]{ return findpaths(pairs, false); });  // ref was validated by the front end.
+
+        ex A = 0;
+        for (size_t c=cache.children; c<children.size(); c++)                                                  // Loop over new children
            {
-               ReferencePointList  path = findpath(ref, myself+":"+*child);                             // Find path from child to reference point, don't check arguments again.
+               ReferencePointList& path = paths[c-cache.children];                                             // Path from child to reference point.
 
                ex term=1;
                if (path.empty())                                                                               // CASE: ref is within myself:child
@@ -1270,11 +1762,12 @@ ex World::GenerateRefToAll( refPoint ref, int depth, int varForm )
                   
                A+=term;                                                                                         // Each child contribute a form factor amplitude term
            }
-           
-        return A;
+
+        UpdateTermCache(cache, A, children, outer);
+        return scope.Result(cache.terms);
     }
     else if (isSubunit(myself))                                                                                // We have reached a sub-unit. Just return the equation.
-        return getSubunit(myself)->FormFactorAmplitude(getReference(ref), betas, params, varForm);  
+        return scope.Result(scope.Timed(stats.subunits, [&]{ return getSubunit(myself)->FormFactorAmplitude(getReference(ref), betas, params, varForm); }));
     else
     throw SEBException("Something wrong with the object given", "ex World::GenerateRefToAll( refPoint "+ref+", int "+to_string(depth)+",..)");
 }
@@ -1282,59 +1775,389 @@ ex World::GenerateRefToAll( refPoint ref, int depth, int varForm )
 
 /*    Calculates form factor of a structure or sub-unit within the world.
 
+      When children have been linked to a structure since its form factor was last derived, only the terms
+      involving the new children are derived, that is their own form factors and their interference with all
+      other children. The latter requires a path to and an interference term with every earlier child, so the cost
+      of adding a child grows linearly with the number of children already in the structure.
 */
 ex World::GenerateAllToAll( structName myself, int depth , int varForm)
 {
+   StatsScope scope(*this);
+   TraceSpan span(*this, "GenerateAllToAll", myself, depth);
    if(isStructure(myself))
     {
         // Depth 0 reached, but we are still in structure, so return a GENERIC expression.
-        if(depth == 0) return getFF( myself, varForm );
+        if(depth == 0) return scope.Result(getFF( myself, varForm ));
 
-        ex F = 0;
         Structure *sptr = getStructure(myself);
         GraphID gid = sptr->getGraphID();
-        
-        for (auto child1=subgraph_cbegin(gid) ; child1!= subgraph_cend(gid) ; ++child1)                    // Loop over pairs of children
-           {
-              for (auto child2=child1 ; child2!=subgraph_cend(gid) ; ++child2)                       
-               {
-                    string child1name = *child1;
-                    string child2name = *child2;
 
-                    ex Fterm=0;
-                    if (child1==child2)                                                                                  // Diagonal term
-{
-                             Fterm=GenerateAllToAll( child1name, depth-1, varForm);                                         // Add form factor of child.
+        TermCache& cache = getTermCache( make_tuple(myself, depth, varForm), gid );                            // Terms of children already derived.
+        if (isUpToDate(cache, gid)) return scope.Result(cache.terms);                                          // No new children since last derivation.
+        vector<string> children( subgraph_cbegin(gid), subgraph_cend(gid) );
+        ParameterScope outer(*this);                                                                           // Collect parameters of the new terms separately.
 
-}
-                      else                                                                                               
-                        {                                                                                                // Add interference term between the two children.
-                             ReferencePointList  path = findpath(myself+":"+child1name, myself+":"+child2name, false);   // find path connecting the two children
-                             
-                             ex A1 =GenerateRefToAll( path.front(), depth-1, varForm);                      // Amplitude of child1 relative to first step in path
-                             ex Psi=PhaseFactor(      path        , depth-1, myself, varForm);              // phase factors due to path
-                             ex A2 =GenerateRefToAll( path.back() , depth-1, varForm);                      // Amplitude of child2 relative to last step in path
-                             
-                             Fterm=2*A1*Psi*A2;
-                                    
-                        }
+        vector<pair<string, string>> pairs;                                                                    // Find paths between new children and all previous children first.
+        for (size_t c2=cache.children; c2<children.size(); c2++)
+           for (size_t c1=0; c1<c2; c1++)
+              pairs.push_back( make_pair(myself+":"+children[c1], myself+":"+children[c2]) );
+        vector<ReferencePointList> paths = scope.Timed(stats.pathsearch, [&]{ return findpaths(pairs, false); });
+        int p = 0;
 
+        ex F = 0;
+        for (size_t c2=cache.children; c2<children.size(); c2++)                                               // Loop over new children
+           {
+              F+=GenerateAllToAll( children[c2], depth-1, varForm);                                             // Diagonal term: form factor of child.
 
-                    F+=Fterm;
+              for (size_t c1=0; c1<c2; c1++)                                                                    // Add interference terms with all previous children.
+               {
+                    ReferencePointList& path = paths[p++];                                                      // path connecting the two children
+                             
+                    ex A1 =GenerateRefToAll( path.front(), depth-1, varForm);                      // Amplitude of child1 relative to first step in path
+                    ex Psi=PhaseFactor(      path        , depth-1, myself, varForm);              // phase factors due to path
+                    ex A2 =GenerateRefToAll( path.back() , depth-1, varForm);                      // Amplitude of child2 relative to last step in path
+                             
+                    F+=2*A1*Psi*A2;
                }
-             
            }
-        return F;
+
+        UpdateTermCache(cache, F, children, outer);
+        return scope.Result(cache.terms);
     }
     else if (isSubunit(myself))                                                                                // We have reached a sub-unit. Just return the equation.
     {    
-        return getSubunit(myself)->FormFactor(betas, params, varForm);
+        return scope.Result(scope.Timed(stats.subunits, [&]{ return getSubunit(myself)->FormFactor(betas, params, varForm); }));
     }
     else
     throw SEBException("Something wrong with the object given", "ex World::GenerateAllToAll( structName "+myself+", int depth , int varForm)");
 }
 
 
+/*  Returns the cached terms for a structure, reference point, depth and varform. The terms can be extended with new
+    children as long as no graph nested inside the structure has changed, except the graph of the structure itself.
+    Otherwise the cache entry is reset, and all terms are derived again.
+*/
+World::TermCache& World::getTermCache(const tuple<string, int, int>& key, GraphID gid)
+{
+    auto it = termCache.find(key);
+    if (it != termCache.end())
+      {
+        TermCache& cache = it->second;
+        bool valid = true;
+        for (size_t v=cache.version; v<linkLog.size() && valid; v++)
+            if (linkLog[v] != gid && cache.nested.count(linkLog[v])) valid = false;
+
+        if (valid)
+          {
+            cache.version = linkLog.size();
+            return cache;
+          }
+      }
+
+    TermCache& cache = termCache[key];
+    cache = TermCache();
+    cache.nested.insert(gid);
+    return cache;
+}
+
+/*  If no children were linked to the structure since the terms were derived, merge their parameters and return true. */
+bool World::isUpToDate(TermCache& cache, GraphID gid)
+{
+    if (cache.children != subGraphs.find(gid)->second.size())
+      {
+        if (collectStats) stats.cacheMisses++;
+        return false;
+      }
+    if (collectStats) stats.cacheHits++;
+
+    betas.insert(cache.betas.begin(), cache.betas.end());
+    params.insert(cache.params.begin(), cache.params.end());
+    return true;
+}
+
+/*  Adds newly derived terms to the cache, and merges the parameters of all terms into the parameters collected by
+    the caller, which are restored when outer goes out of scope. */
+void World::UpdateTermCache(TermCache& cache, const ex& terms, const vector<string>& children, ParameterScope& outer)
+{
+    cache.terms += terms;
+    cache.betas.insert(betas.begin(), betas.end());
+    cache.params.insert(params.begin(), params.end());
+
+    for (size_t c=cache.children; c<children.size(); c++)
+        if (isStructure(children[c])) NestedGraphs( getStructure(children[c])->getGraphID(), cache.nested );
+
+    cache.children = children.size();
+    cache.version = linkLog.size();
+
+    outer.betas.insert(cache.betas.begin(), cache.betas.end());
+    outer.params.insert(cache.params.begin(), cache.params.end());
+}
+
+void World::ClearTermCache()
+{
+    termCache.clear();
+}
+
+// Adds gid and all graphs nested inside structures in gid.
+void World::NestedGraphs(GraphID gid, set<GraphID>& nested)
+{
+    if (!nested.insert(gid).second) return;
+
+    for (auto child = subgraph_cbegin(gid); child != subgraph_cend(gid); ++child)
+        if (isStructure(*child)) NestedGraphs( getStructure(*child)->getGraphID(), nested );
+}
+
+
+void World::setStatistics(bool on)
+{
+    lock_guard<mutex> lock(statsMutex);
+    collectStats = on;
+    stats = DerivationStatistics();
+}
+
+DerivationStatistics World::Stats()
+{
+    lock_guard<mutex> lock(statsMutex);
+    return stats;
+}
+
+World::StatsScope::StatsScope(World& world) : w(world)
+{
+    if (!w.collectStats) return;
+
+    level = w.statsLevel++;
+    if (w.stats.calls.size() <= (size_t) level)
+      {
+        w.stats.calls.resize(level+1, 0);
+        w.stats.terms.resize(level+1, 0);
+      }
+    w.stats.calls[level]++;
+
+    if (level == 0)
+      {
+        w.stats.derivations++;
+        symbols = w.GLEX->size();
+        t0 = chrono::steady_clock::now();
+      }
+}
+
+World::StatsScope::~StatsScope()
+{
+    if (level < 0) return;
+
+    w.statsLevel--;
+    if (level == 0)
+      {
+        w.stats.total += chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+        w.stats.symbolsCreated += w.GLEX->size()-symbols;
+      }
+}
+
+const ex& World::StatsScope::Result(const ex& e)
+{
+    if (level >= 0) w.stats.terms[level] += is_a<add>(e) ? e.nops() : !e.is_zero();
+    return e;
+}
+
+string DerivationStatistics::JSON() const
+{
+    ostringstream os;
+    os << "{ \"derivations\": " << derivations << ", \"findpath\": " << findpathCalls << ", \"visited\": " << visited
+       << ", \"cachehits\": " << cacheHits << ", \"cachemisses\": " << cacheMisses << ", \"symbols\": " << symbolsCreated
+       << ", \"calls\": [";
+    for (size_t l=0; l<calls.size(); l++) os << (l ? ", " : "") << calls[l];
+    os << "], \"terms\": [";
+    for (size_t l=0; l<terms.size(); l++) os << (l ? ", " : "") << terms[l];
+    os << "], \"time\": { \"total\": " << total << ", \"pathsearch\": " << pathsearch << ", \"subunits\": " << subunits
+       << ", \"assembly\": " << total-pathsearch-subunits << " } }";
+    return os.str();
+}
+
+
+/*  Estimated cost of a function call per q value in units of one addition or multiplication, the names are those
+    Evaluator can compile. */
+static double FunctionCost(const string& name)
+{
+    static const map<string, double> cost = {
+        { "sin", 15 }, { "cos", 15 }, { "tan", 20 }, { "exp", 15 }, { "log", 15 }, { "abs", 1 },
+        { "sinh", 20 }, { "cosh", 20 }, { "tanh", 20 }, { "asin", 20 }, { "acos", 20 }, { "atan", 20 },
+        { "csc", 16 }, { "sec", 16 }, { "power", 30 },
+        { "BesselJ0", 40 }, { "BesselJ1", 40 }, { "BesselJ2", 80 }, { "DawsonF", 40 }, { "Si", 60 }, { "Six", 60 },
+        { "Erf", 30 }, { "Erfc", 30 }, { "StruveH0", 150 }, { "StruveH1", 150 }, { "Hypergeometric0F1Regularized", 100 } };
+
+    auto it = cost.find(name);
+    return it == cost.end() ? 50 : it->second;
+}
+
+// Integrand evaluations per integral, Evaluator uses 16 point Gauss-Legendre on at least 4 and 8 panels.
+static const double integrandEvaluations = 16*(4+8);
+
+/*  Adds the distinct sub-expressions of e not already visited to c, and their cost to cost. As in Evaluator,
+    integrands are separate programs, hence they are visited separately, and their cost multiplied by the number of
+    integrand evaluations. treesize remembers the size of every sub-expression in the expression tree. */
+static double AddComplexity(const ex& e, exset& visited, map<ex, double, ex_is_less>& treesize, ExpressionComplexity& c, double& cost)
+{
+    if (!visited.insert(e).second) return treesize.at(e);
+    c.distinct++;
+
+    double nodes = 1;
+    if (is_a<integral>(e))
+      {
+        c.integrals++;
+        nodes += 1 + AddComplexity(e.op(1), visited, treesize, c, cost) + AddComplexity(e.op(2), visited, treesize, c, cost);
+
+        exset inner;
+        double integrand = 0;
+        nodes += AddComplexity(e.op(3), inner, treesize, c, integrand);
+        cost += integrandEvaluations*integrand;
+      }
+    else
+      {
+        for (size_t i=0; i<e.nops(); i++) nodes += AddComplexity(e.op(i), visited, treesize, c, cost);
+
+        if (is_a<add>(e) || is_a<mul>(e)) cost += e.nops()-1;
+        else if (is_a<GiNaC::power>(e))
+          {
+            ex expo = e.op(1);
+            bool number = is_a<numeric>(expo) && ex_to<numeric>(expo).is_real();
+            if      (number && ex_to<numeric>(expo).is_integer())   cost += 2;        // As OPPOWINT, OPSQRT or OPPOW in Evaluator.
+            else if (number && ex_to<numeric>(expo).to_double()==0.5) cost += 4;
+            else                                                     cost += FunctionCost("power");
+          }
+        else if (is_a<GiNaC::function>(e))
+          {
+            string name = ex_to<GiNaC::function>(e).get_name();
+            c.functions[name]++;
+            cost += FunctionCost(name);
+          }
+      }
+
+    treesize[e] = nodes;
+    return nodes;
+}
+
+/*  Time per cost unit and q value, measured once by evaluating a reference expression with a mix of arithmetic,
+    powers and special functions for 1024 q values. */
+static double SecondsPerCostUnit()
+{
+    static const double seconds = []
+      {
+        GiNaCLock lock;
+        symbol q("q");
+        ex reference = 0;
+        for (int k=1; k<=32; k++) reference += sin(k*q)/(k*q)*exp(-k*pow(q, 2)) + k*pow(q, 0.3);
+
+        ExpressionComplexity c;
+        exset visited;
+        map<ex, double, ex_is_less> treesize;
+        double cost = 0;
+        AddComplexity(reference, visited, treesize, c, cost);
+
+        Evaluator ev(reference);
+        EvaluatorWorkspace ws;
+        const int lanes = 1024;
+        DoubleVector qvec(lanes);
+        for (int l=0; l<lanes; l++) qvec[l] = 0.01+10.0*l/lanes;
+        ev.Prepare(ws, lanes);
+        ev.setVariable(ws, q, qvec);
+
+        long repeats = 0;
+        auto t0 = chrono::steady_clock::now();
+        double t = 0;
+        while (t < 0.02)
+          {
+            ev.Compute(ws);
+            repeats++;
+            t = chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+          }
+        return t/(repeats*lanes*cost);
+      }();
+
+    return seconds;
+}
+
+ExpressionComplexity World::Complexity(const ex& e)
+{
+    GiNaCLock lock;
+    ExpressionComplexity c;
+    exset visited;
+    map<ex, double, ex_is_less> treesize;
+
+    c.nodes = AddComplexity(e, visited, treesize, c, c.cost);
+    c.seconds = c.cost*SecondsPerCostUnit();
+    return c;
+}
+
+string ExpressionComplexity::JSON() const
+{
+    ostringstream os;
+    os << "{ \"nodes\": " << nodes << ", \"distinct\": " << distinct << ", \"integrals\": " << integrals << ", \"functions\": { ";
+    for (auto it = functions.begin(); it != functions.end(); ++it)
+        os << (it == functions.begin() ? "" : ", ") << "\"" << it->first << "\": " << it->second;
+    os << " }, \"cost\": " << cost << ", \"seconds\": " << seconds << " }";
+    return os.str();
+}
+
+
+void World::setTracing(bool on)
+{
+    lock_guard<mutex> lock(statsMutex);
+    tracing = on;
+    traceEvents.clear();
+    traceThreads.clear();
+    traceStart = chrono::steady_clock::now();
+}
+
+/*  Writes complete events ("ph": "X") in the Chrome trace event format, nested spans on the same thread are shown as a flame graph. */
+void World::WriteTrace(string filename)
+{
+try{
+    ofstream fo(filename);
+    if (!fo.is_open()) throw SEBException("Can not open output file "+filename);
+
+    lock_guard<mutex> lock(statsMutex);
+    fo << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (size_t i=0; i<traceEvents.size(); i++)
+      {
+         const TraceEvent& e = traceEvents[i];
+         fo << "  { \"name\": \"" << e.name << "\", \"cat\": \"" << e.category << "\", \"ph\": \"X\", \"ts\": " << e.start
+            << ", \"dur\": " << e.duration << ", \"pid\": 1, \"tid\": " << e.thread << ", \"args\": { " << e.args << " } }"
+            << (i+1<traceEvents.size() ? ",\n" : "\n");
+      }
+    fo << "] }\n";
+}
+catch (SEBException& e)
+{
+   e.PushCallStack("void World::WriteTrace(string filename=\""+filename+"\")");
+   throw;
+}
+}
+
+World::TraceSpan::TraceSpan(World& world, const char* cat, const string& n, int d, const string* ref1, const string* ref2) : w(world), on(world.tracing)
+{
+    if (!on) return;
+
+    event.category = cat;
+    event.name = n;
+    if (d >= 0) event.args = "\"depth\": "+to_string(d);
+    if (ref1)   event.args += string(event.args.empty() ? "" : ", ")+"\"r1\": \""+*ref1+"\"";
+    if (ref2)   event.args += ", \"r2\": \""+*ref2+"\"";
+    t0 = chrono::steady_clock::now();
+}
+
+World::TraceSpan::~TraceSpan()
+{
+    if (!on) return;
+
+    auto t1 = chrono::steady_clock::now();
+    lock_guard<mutex> lock(w.statsMutex);
+    event.start    = chrono::duration<double, micro>(t0-w.traceStart).count();
+    event.duration = chrono::duration<double, micro>(t1-t0).count();
+    event.thread   = w.traceThreads.emplace(this_thread::get_id(), (int) w.traceThreads.size()).first->second;
+    w.traceEvents.push_back(std::move(event));
+}
+
+
 
 
 
@@ -1348,6 +2171,8 @@ ex World::PhaseFactor(ReferencePointList& path, int depth, string myself, int va
     if (depth<0)  throw SEBException("Depth can not be negative.",
                            "World::getPhaseFactor( path,"+to_string(depth)+", int varForm="+to_string(varForm)+")");
 
+    TraceSpan span(*this, "PhaseFactor", myself, depth);
+
 //    cout << "getPhaseFactor called with path: ";
 //    printList(path); cout << "\n";
 
@@ -1673,6 +2498,8 @@ ex World::getPsi(string myself, refPoint r1, refPoint r2, int varform)
                                    {
                                       ex psi=GLEX->getSymbol("Psi", myself, r1, r2);
                                       params[psi]=0;
+                                      string sep = isSubunit(myself) ? "." : ":";
+                                      genericTerms[psi] = GenericTerm{'P', myself, myself+sep+r1, myself+sep+r2};
                                       return psi;
                                    }
 }        
@@ -1703,6 +2530,8 @@ ex World::getFFA(string myself, refPoint r, int varform)
                                       
                                       betas[beta]=0;
                                       params[A]=0;
+                                      genericTerms[beta] = GenericTerm{'B', myself, "", ""};
+                                      genericTerms[A] = GenericTerm{'A', myself, myself+":"+r, ""};
 
                                       return beta*A;
                                    }
@@ -1733,6 +2562,8 @@ ex World::getFF(string myself, int varform)
 
                                       betas[beta]=0;                                      
                                       params[F]=0;
+                                      genericTerms[beta] = GenericTerm{'B', myself, "", ""};
+                                      genericTerms[F] = GenericTerm{'F', myself, "", ""};
 
                                       return beta*beta*F;
                                    }
@@ -8,11 +8,22 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <thread>
 
 #include "Types.hpp"
 #include "Constants.hpp"
 #include "SymbolInterface.hpp"
 #include "SpecialFunctions.hpp"
+#include "Evaluator.hpp"
+#include "Polydispersity.hpp"
+#include "Resolution.hpp"
+#include "StructureFactors.hpp"
+#include "AdaptiveGrid.hpp"
+#include "Parallel.hpp"
+#include "Pool.hpp"
 
 #include "Structure.hpp"
 #include "Subunit.hpp"
@@ -23,10 +34,80 @@
 // used namespaces
 using namespace std;
 
+/*
+    A path to a reference point (e.g. "chain:star1:diblock1:polyB.end2") or a structure / sub-unit, that has been
+    parsed and validated once by World::ref(). The World methods deriving expressions, and the X, Generic, Normalization,
+    size and count variants, have overloads taking handles, which skip validating the path again. The derivation itself
+    still works on the path. Worlds only grow, hence a handle remains valid for the lifetime of its world.
+*/
+class RefHandle
+{
+    friend class World;
+
+    const World* world = nullptr;
+    string path;                 // The full path as given to World::ref()
+    vector<string> names;        // Chain of structure names ending with a structure / sub-unit name, e.g. chain, star1, diblock1, polyB
+    string reference;            // Reference point on the last sub-unit e.g. end2, empty if the path denotes a structure / sub-unit
+
+public:
+    const string& getPath()              const { return path; }
+    const vector<string>& getNames()     const { return names; }
+    const string& getReference()         const { return reference; }
+    bool isReferencePoint()              const { return !reference.empty(); }
+};
+
+/*
+    Counters collected by a World while deriving scattering expressions, when enabled by World::setStatistics.
+    Levels count the recursion of the derivation from the structure given by the user (level 0) and down.
+    Times are wall times in seconds, the time spent assembling expressions is total - pathsearch - subunits.
+*/
+struct DerivationStatistics
+{
+    long derivations = 0;             // Top level derivations, e.g. FormFactor derives both the terms and their normalization.
+    long findpathCalls = 0;           // Path searches,
+    long visited = 0;                 // and the reference points they visited.
+    long cacheHits = 0;               // Terms of structures found in the term cache,
+    long cacheMisses = 0;             // or (partially) derived.
+    long symbolsCreated = 0;          // Symbols added to the symbol interface.
+
+    vector<long> calls;               // Calls of GenerateRefToRef, GenerateRefToAll and GenerateAllToAll at each level,
+    vector<long> terms;               // and the number of terms in the expressions they returned.
+
+    double total = 0, pathsearch = 0, subunits = 0;
+
+    // As a JSON object
+    string JSON() const;
+};
+
+/*
+    Size and estimated evaluation cost of an expression, see World::Complexity. Costs are in units of one addition or
+    multiplication per q value, with special functions weighted by their typical cost, and integrands by the least number
+    of quadrature points Evaluator uses. The time is the cost times the time per unit measured once on this computer.
+*/
+struct ExpressionComplexity
+{
+    double nodes = 0;                 // Nodes in the expression tree (can be astronomical, hence double),
+    long distinct = 0;                // and distinct sub-expressions, i.e. nodes compiled by Evaluator.
+    map<string, long> functions;      // Distinct special function calls by name,
+    long integrals = 0;               // and integrals.
+    double cost = 0;                  // Estimated cost per q value,
+    double seconds = 0;               // and estimated time per q value.
+
+    // As a JSON object
+    string JSON() const;
+};
+
 class World
 {
+    // Simulator walks the links of structures to generate conformations.
+    friend class Simulator;
+
 private:
 
+    /* The GiNaC lock, held from the start of the destructor until all members holding GiNaC expressions have been
+       destroyed. Declared first, hence destroyed last. */
+    unique_lock<recursive_mutex> destructionLock;
+
     /* Name of world, not really used anywhere. */
     string worldId;
     
@@ -46,13 +127,22 @@ private:
     /* storage of all sub-units/structures known by world by their unique name. Here names not paths, so no : anywhere. */
     map<string, ABSSubUnit*> nameCatalog;
 
+    /* Sub-units and structures created by the world itself are allocated here, in chunks per type. */
+    Pool pool;
+
     /* Each connected graph of sub-units or structures has a unique graphID. When a new sub-unit is linked to an
     existing sub-unit, it automagically shares its graphid, similar when a structure is linked to a structure */
     int totalNumberofGraphs = 0;
     
     /* Map listing all the sub-unit / structure names inside each sub-graph. */
     map<GraphID, list<string>> subGraphs;
+
+    /* Reverse map from sub-unit / structure name to the sub-graph containing it, maintained together with subGraphs. */
+    unordered_map<string, GraphID> graphOfName;
     
+    /* First sub-unit initialized for each (sub-unit type, tag). Later sub-units with the same type and tag share its scattering expressions. */
+    map<pair<int, string>, SubUnit*> prototypes;
+
     /*   sub-unit name -> type map.  WHY THIS WHEN sub-units knows their own type? */
     map<subName, int> typeCatalog;
     
@@ -60,28 +150,155 @@ private:
     map<pair<string, string>, list<refPoint>> alreadyKnownPaths;
     int numberOfPathsFound = 0; //For print to the user.
 
-    /*Pointer to symbol interface*/
+    /*Pointer to symbol interface, either the one shared by all worlds or a private one owned by this world*/
     SymbolInterface *GLEX = SymbolInterface::instance();
+    bool ownsSymbols = false;
     
     // Parameter lists
     ParameterList betas, params;
 
+    /* Terms derived for a structure at a given depth and varform, either its form factor or its form factor amplitude relative
+       to a reference point. When a child is linked to the structure only terms involving the new child are derived.
+       Note that for a form factor these still include one interference term with each earlier child, each requiring a path
+       search, so adding the N'th child costs O(N) rather than O(1), and building a structure child by child O(N^2). */
+    struct TermCache
+    {
+        size_t children = 0;      // Number of children included in terms
+        size_t version  = 0;      // linkLog.size() when terms were updated
+        set<GraphID> nested;      // Graphs nested inside the structure, links to any of these but its own graph invalidate the terms.
+        ex terms = 0;
+        ParameterList betas, params;
+    };
+
+    // Cached terms by (structure name or reference point, depth, varform)
+    map<tuple<string, int, int>, TermCache> termCache;
+
+    // Swaps the parameters collected by the caller out of betas and params, such that the parameters of newly derived
+    // terms are collected separately, and swaps them back when it goes out of scope, also when a derivation throws.
+    class ParameterScope
+    {
+        World& w;
+    public:
+        ParameterList betas, params;     // Collected by the caller.
+        ParameterScope(World& world) : w(world) { swap(w.betas, betas); swap(w.params, params); }
+        ~ParameterScope()                        { swap(w.betas, betas); swap(w.params, params); }
+    };
+
+    // The graph that was grown by each call to Link in order.
+    vector<GraphID> linkLog;
+
+    // Search paths between children on all cores while deriving expressions.
+    bool parallelDerivation = false;
+
+    // Inside Derive, which collects the parameters of all expressions derived.
+    bool deriving = false;
+
+    /* The structure and reference points a GENERIC symbol (F, A, Psi or beta) was generated for at depth 0, such that
+       it can be derived and evaluated on its own when evaluating level by level. */
+    struct GenericTerm
+    {
+        char kind;                // 'F', 'A', 'P' or 'B'
+        string name;              // Structure or sub-unit
+        refPoint r1, r2;          // Reference points with prefix name
+    };
+
+    map<ex, GenericTerm, ex_is_less> genericTerms;
+
+    // Derivation statistics, only collected when enabled.
+    bool collectStats = false;
+    DerivationStatistics stats;
+    mutex statsMutex;                          // Path searches may run on several threads.
+    int statsLevel = 0;                        // Current recursion level of Generate*
+
+    // Counts a call of Generate* at the current level, and times the derivation and the symbols created at level 0.
+    class StatsScope
+    {
+        World& w;
+        int level = -1;
+        size_t symbols = 0;
+        chrono::steady_clock::time_point t0;
+    public:
+        StatsScope(World& world);
+        ~StatsScope();
+
+        // Counts the terms of an expression returned at this level.
+        const ex& Result(const ex& e);
+
+        // Returns f(), adding the time it took to phase.
+        template<class F> auto Timed(double& phase, F f) -> decltype(f())
+          {
+            if (level < 0) return f();
+            auto t = chrono::steady_clock::now();
+            auto ret = f();
+            phase += chrono::duration<double>(chrono::steady_clock::now()-t).count();
+            return ret;
+          }
+    };
+
+    // Trace of the derivation, only recorded when enabled by setTracing.
+    struct TraceEvent
+    {
+        string category, name, args;
+        double start, duration;                // Microseconds since tracing was enabled.
+        int thread;
+    };
+
+    bool tracing = false;
+    vector<TraceEvent> traceEvents;            // Guarded by statsMutex
+    map<thread::id, int> traceThreads;         // Threads numbered in the order they were first seen.
+    chrono::steady_clock::time_point traceStart;
+
+    // Records a span from construction to destruction, e.g. GenerateAllToAll of a structure name at a given depth,
+    // with the reference points involved. Nothing is copied unless tracing.
+    class TraceSpan
+    {
+        World& w;
+        bool on;
+        TraceEvent event;
+        chrono::steady_clock::time_point t0;
+    public:
+        TraceSpan(World& world, const char* cat, const string& n, int d = -1, const string* ref1 = nullptr, const string* ref2 = nullptr);
+        ~TraceSpan();
+    };
+
 public:
-    /*World Constructer with a given id as a string*/
-    World(string id="World")
+    /* A derived scattering expression together with the parameters it depends on. */
+    struct Derivation
+    {
+        ex expression;
+        ParameterList parameters;
+    };
+
+    /*World Constructer with a given id as a string. With privateSymbols the world gets its own symbol table,
+      which allows several worlds to be built and evaluated on different threads (see GiNaCLock). */
+    World(string id="World", bool privateSymbols=false)
     {
         worldId = id;
+        if (privateSymbols)
+          {
+            GiNaCLock lock;
+            GLEX = new SymbolInterface();
+            ownsSymbols = true;
+          }
 #ifdef SPECIALFUNCTIONSERIES
         cout << "WARNING: This was compiled with -DSPECIALFUNCTIONSERIES, which should only be used when validating the sub-unit scattering expressions, NOT during production.\n";
 #endif        
     };
     
+    // Worlds own their sub-units and structures, and can not be copied.
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
     ~World(){
-        // release allocated sub-units / structures.
-        for (auto it = nameCatalog.begin(); it != nameCatalog.end(); ++it) delete it->second;
+        destructionLock = unique_lock<recursive_mutex>(GiNaCMutex());
+
+        // release sub-units / structures allocated by the user, and then everything in the pool.
+        for (auto it = nameCatalog.begin(); it != nameCatalog.end(); ++it)
+            if (!it->second->pooled) delete it->second;
+        pool.Clear();
 
-        // release symbol interface
-        GLEX->~SymbolInterface();
+        // release symbol interface if private, the shared one lives until the program ends.
+        if (ownsSymbols) delete GLEX;
     };
 
     /* Get graphID from a sub-unit or structure name / sub-unit pointer */
@@ -129,10 +346,16 @@ public:
     GraphID Add(SubUnit *sub, subName name, string tag = "");
     GraphID Add(string, subName name, string tag = "");
 
+    /* Same, but the sub-unit of type T is created in the world's pool, e.g. w.Add<GaussianPolymer>("poly0", "poly") */
+    template<class T> GraphID Add(subName name, string tag = "") { return Add(Create<T>(), name, tag); }
+
     /* Adds a new sub-unit and links it with an existing sub-unit by a the specified reference point. This grows the graph */
     GraphID Link(SubUnit *sub2, refPoint r2, refPoint r1, string tag = "");
     GraphID Link(string, refPoint r2, refPoint r1, string tag = "");
 
+    /* Same, but the sub-unit of type T is created in the world's pool, e.g. w.Link<GaussianPolymer>("poly1.end1", "poly0.end2", "poly") */
+    template<class T> GraphID Link(refPoint r2, refPoint r1, string tag = "") { return Link(Create<T>(), r2, r1, tag); }
+
     /* Wraps a given graph in a structure name. The graph now is a node that we can build with. */
     GraphID Add(GraphID gid, structName name);
 
@@ -147,6 +370,11 @@ public:
     // Return a list of all parameters for LAST evaluated expression.
     ParameterList getParams();
 
+    // Run a derivation, e.g. [&]{ return w.FormFactor("star"); }, and return the expression together with the parameters of
+    // all expressions derived by it. The parameters collected by the world (getParams) are left untouched.
+    // The GiNaC lock is held throughout, so the result is consistent even when other threads derive expressions.
+    Derivation Derive(const std::function<ex()>& derivation);
+
     // Returns a copy of all parameters, involving q.
     ParameterList getParamsq();
 
@@ -173,59 +401,140 @@ public:
     // Evaluate expression for given parameters for a vector of q values, returns a vector of values
     DoubleVector Evaluate(ex, ParameterList&, DoubleVector& ); 
     
+    // Evaluate several expressions of the same structures (e.g. F, A and phase factors) together for a vector of q values.
+    // Sub-expressions shared between the expressions, such as sub-unit form factors, are only evaluated once per q value.
+    vector<DoubleVector> Evaluate(const vector<ex>&, ParameterList&, DoubleVector& );
+
     // This does the same as the function above, but saves the result to a file.
     // The first optional argument is a user text, the second the character denoting a comment.
     DoubleVector Evaluate(ex e, ParameterList& pl, DoubleVector& q, string, string ="", string = "#");
 
+    // Declare the parameter named str polydisperse with a distribution (SCHULZ, LOGNORMAL, GAUSSIAN), relative width sigma/mean, and number of quadrature nodes.
+    void setPolydispersity(Polydispersity& pd, string str, int family, double width, int nodes = 20);
+
+    // Evaluate expression averaged over polydisperse parameters for a vector of q values. Mean values are taken from the parameter list.
+    DoubleVector Evaluate(ex, ParameterList&, DoubleVector&, Polydispersity&);
+
+    // Evaluate the polydisperse averages <F> and <A>^2 needed by decoupling approximations  I(q) = <F> + <A>^2 (S(q)-1)
+    void EvaluateDecoupling(ex F, ex A, ParameterList& pl, DoubleVector& q, Polydispersity& pd, DoubleVector& Favg, DoubleVector& A2avg);
+
+    // Evaluate the decoupling approximation I(q) = F + A^2 (S(q)-1) with an analytic structure factor, optionally with polydispersity.
+    // Use DecouplingModel directly to evaluate many structure factors for the same F and A.
+    DoubleVector EvaluateDecoupling(ex F, ex A, ParameterList& pl, DoubleVector& q, StructureFactor& S);
+    DoubleVector EvaluateDecoupling(ex F, ex A, ParameterList& pl, DoubleVector& q, Polydispersity& pd, StructureFactor& S);
+
+    // Evaluate expression smeared by the instrumental resolution for a vector of q values, optionally also averaged over polydisperse parameters.
+    DoubleVector Evaluate(ex, ParameterList&, DoubleVector&, Resolution&);
+    DoubleVector Evaluate(ex, ParameterList&, DoubleVector&, Polydispersity&, Resolution&);
+
+    // Evaluate the form factor of a structure level by level. The expression is derived depth levels down, and the F, A and Psi
+    // of the structures at that depth are evaluated numerically for each q in the same way, before being inserted. Hence the fully
+    // expanded expression is never generated. Every structure must have a non-zero sum of excess scattering lengths.
+    DoubleVector EvaluateByLevels(string name, ParameterList&, DoubleVector&, int depth = 1);
+
+    // Evaluate expression on an adaptively refined q grid between q1 and q2, such that the interpolant is accurate to tolerance.
+    AdaptiveGrid EvaluateAdaptive(ex, ParameterList&, double q1, double q2, double tolerance = 1e-3, int maxpoints = 10000);
+
     // These methods are used to produce analytic expressions for scattering tems   --------------------------------------
 
     // Methods for getting phase factors, normalization is never an issue for phase factors.
     ex PhaseFactor        ( refPoint r1, refPoint r2, int depth = WORLDMAXDEPTH, int varform=QVAR);
+    ex PhaseFactor        ( const RefHandle& r1, const RefHandle& r2, int depth = WORLDMAXDEPTH, int varform=QVAR);
     ex PhaseFactorX       ( refPoint r1, refPoint r2, int depth = WORLDMAXDEPTH);
+    ex PhaseFactorX       ( const RefHandle& r1, const RefHandle& r2, int depth = WORLDMAXDEPTH);
     ex PhaseFactorGeneric ( refPoint r1, refPoint r2, int depth = WORLDMAXDEPTH);
+    ex PhaseFactorGeneric ( const RefHandle& r1, const RefHandle& r2, int depth = WORLDMAXDEPTH);
 
     // Methods for getting F->1 for q->0 normalized form factors and form factor amplitudes
     ex FormFactorAmplitude        ( refPoint ref, int depth = WORLDMAXDEPTH, int varForm = QVAR );
+    ex FormFactorAmplitude        ( const RefHandle& ref, int depth = WORLDMAXDEPTH, int varForm = QVAR );
     ex FormFactorAmplitudeX       ( refPoint ref, int depth = WORLDMAXDEPTH);
+    ex FormFactorAmplitudeX       ( const RefHandle& ref, int depth = WORLDMAXDEPTH);
     ex FormFactorAmplitudeGeneric ( refPoint ref, int depth = WORLDMAXDEPTH);
+    ex FormFactorAmplitudeGeneric ( const RefHandle& ref, int depth = WORLDMAXDEPTH);
     ex FormFactor        ( string name, int depth = WORLDMAXDEPTH, int varForm = QVAR );
+    ex FormFactor        ( const RefHandle& name, int depth = WORLDMAXDEPTH, int varForm = QVAR );
     ex FormFactorX       ( string name, int depth = WORLDMAXDEPTH);
+    ex FormFactorX       ( const RefHandle& name, int depth = WORLDMAXDEPTH);
     ex FormFactorGeneric ( string name, int depth = WORLDMAXDEPTH);
+    ex FormFactorGeneric ( const RefHandle& name, int depth = WORLDMAXDEPTH);
 
     // Methods for getting unnormalized form factors and - amplitudes. 
     // For q->0 they converge to sum beta
     ex FormFactorAmplitude_Unnormalized( refPoint ref, int depth = WORLDMAXDEPTH, int varForm = QVAR );
+    ex FormFactorAmplitude_Unnormalized( const RefHandle& ref, int depth = WORLDMAXDEPTH, int varForm = QVAR );
     ex FormFactorAmplitudeX_Unnormalized       ( refPoint ref, int depth = WORLDMAXDEPTH);
+    ex FormFactorAmplitudeX_Unnormalized       ( const RefHandle& ref, int depth = WORLDMAXDEPTH);
     ex FormFactorAmplitudeGeneric_Unnormalized( refPoint ref, int depth = WORLDMAXDEPTH);
+    ex FormFactorAmplitudeGeneric_Unnormalized( const RefHandle& ref, int depth = WORLDMAXDEPTH);
 
     // For q->0 they converge to (sum beta)^2
     ex FormFactor_Unnormalized        ( string name, int depth = WORLDMAXDEPTH, int varForm = QVAR );
+    ex FormFactor_Unnormalized        ( const RefHandle& name, int depth = WORLDMAXDEPTH, int varForm = QVAR );
     ex FormFactorX_Unnormalized       ( string name, int depth = WORLDMAXDEPTH);
+    ex FormFactorX_Unnormalized       ( const RefHandle& name, int depth = WORLDMAXDEPTH);
     ex FormFactorGeneric_Unnormalized( string name, int depth = WORLDMAXDEPTH);
+    ex FormFactorGeneric_Unnormalized( const RefHandle& name, int depth = WORLDMAXDEPTH);
 
     // Normalization constants
     ex FormFactorAmplitude_Normalization( refPoint ref, int depth = WORLDMAXDEPTH );    // = sum beta
+    ex FormFactorAmplitude_Normalization( const RefHandle& ref, int depth = WORLDMAXDEPTH );
     ex FormFactor_Normalization       ( string name, int depth = WORLDMAXDEPTH);        // = (sum beta)^2
+    ex FormFactor_Normalization       ( const RefHandle& name, int depth = WORLDMAXDEPTH);
    
     // These methods are used to provide analytic expressions for Radius of gyration etc. ---------------------------------
 
     // Measure apparent sizes. Weighed by beta terms and normalized by (sum beta)^2 and (sum beta), respectively.
     ex RadiusOfGyration2( string name, int depth = WORLDMAXDEPTH );
+    ex RadiusOfGyration2( const RefHandle& name, int depth = WORLDMAXDEPTH );
     ex SMSD_ref2scat( refPoint ref, int depth = WORLDMAXDEPTH );
+    ex SMSD_ref2scat( const RefHandle& ref, int depth = WORLDMAXDEPTH );
 
     // Measure absolute mean-square distance between reference point pairs.
     ex SMSD_ref2ref( refPoint r1, refPoint r2, int depth = WORLDMAXDEPTH);
+    ex SMSD_ref2ref( const RefHandle& r1, const RefHandle& r2, int depth = WORLDMAXDEPTH);
 
     // Miscellanious methods. --------------------------------------------------------------------------------------------
 
     // Count number of structures/sub-units connected to ref at the specifie depth
     ex Count(refPoint ref, int depth = WORLDMAXDEPTH);
+    ex Count(const RefHandle& ref, int depth = WORLDMAXDEPTH);
     
     // Count number of pairs of structures/sub-units within structure at specific depth. Count / Countpairs returns N vs. N^2 elements.
     ex CountPairs( string name, int depth = WORLDMAXDEPTH);
+    ex CountPairs( const RefHandle& name, int depth = WORLDMAXDEPTH);
 
     // Find a path of reference points connecting the two reference points, recursing fown to the specified level.  (NOT used by SEB)
     ReferencePointList  Path( refPoint r1, refPoint r2, int depth=WORLDMAXDEPTH, bool =true);
+    ReferencePointList  Path( const RefHandle& r1, const RefHandle& r2, int depth=WORLDMAXDEPTH);
+
+    // Parse and validate a path to a reference point or structure / sub-unit once, e.g. w.ref("chain:star1:diblock1:polyB.end2")
+    RefHandle ref(string path);
+
+    // Enable parallel derivation. Paths between the children of large structures are then searched for on all cores,
+    // while the expression is assembled in the same order as serially, hence the derived expressions are identical.
+    void setParallelDerivation(bool on = true) { parallelDerivation = on; }
+
+    // Release the terms cached for all structures, e.g. to free memory after deriving large structures.
+    // Later derivations start from scratch.
+    void ClearTermCache();
+
+    // Collect derivation statistics (see DerivationStatistics) from now on, or stop collecting them. Resets the counters.
+    void setStatistics(bool on = true);
+
+    // Statistics collected since setStatistics was called, use Stats().JSON() for a JSON object.
+    DerivationStatistics Stats();
+
+    // Record a trace of the recursion of derivations from now on, or stop recording. Clears the trace.
+    void setTracing(bool on = true);
+
+    // Size and estimated cost per q value of evaluating an expression, e.g. to decide between evaluating the fully expanded
+    // expression and EvaluateByLevels. The first call measures the time per cost unit on this computer.
+    ExpressionComplexity Complexity(const ex& e);
+
+    // Writes the trace as Chrome trace events, which can be viewed in Perfetto (ui.perfetto.dev) or chrome://tracing.
+    // Spans are named by the structure / sub-unit, and categorized by the method (GenerateAllToAll, findpath, ...).
+    void WriteTrace(string filename);
 
     // Expose symbols to the user.
     SymbolInterface* GetSymbolInterface() { return GLEX; }
@@ -239,6 +548,32 @@ public:
     ex GenerateRefToAll( refPoint r,               int depth, int varForm );
     ex GenerateAllToAll( string name,              int depth, int varForm );
   
+    // Creates a sub-unit or structure in the pool.
+    template<class T, class... Args> T* Create(Args&&... args)
+      {
+        T* p = pool.Create<T>(std::forward<Args>(args)...);
+        static_cast<ABSSubUnit*>(p)->pooled = true;
+        return p;
+      }
+
+    // Initializes a sub-unit, sharing scattering expressions with a previous sub-unit of the same type and tag.
+    // Sub-units are registered as prototypes once the world owns them.
+    void InitSubunit(SubUnit *sub, subName name, string tag);
+    void RegisterPrototype(SubUnit *sub, subName name, string tag);
+
+    // Clears the parameters collected, when a front end starts deriving a new expression.
+    void ResetParameters();
+
+    // Helpers for incrementally updating terms of structures when they grow.
+    TermCache& getTermCache(const tuple<string, int, int>& key, GraphID gid);
+    bool isUpToDate(TermCache& cache, GraphID gid);
+    void UpdateTermCache(TermCache& cache, const ex& terms, const vector<string>& children, ParameterScope& outer);
+    void NestedGraphs(GraphID gid, set<GraphID>& nested);
+
+    // Finds the paths between each pair of reference points / names, in parallel for many pairs when parallel derivation is enabled.
+    vector<ReferencePointList> findpaths(const vector<pair<string, string>>& pairs, bool check);
+    void CountPathSearch(long visited);
+
     // Makes a list of all neighbors, that is link partners, and reference points inside the same structure / sub-unit
     ReferencePointList getNeighbors( refPoint last, ReferencePointList& VisitedAlready);
     
@@ -282,6 +617,9 @@ public:
     string getReferenceBaseHash(string);   // Identical to getReferenceBase except it throws unless noth . and # are in string.
     string getReferenceAfterHash(string);  // Returns everything after #,   throws if no # or # last character
 
+    // Throws unless the handle was made by this world.
+    void testHandle(const RefHandle& h);
+
     // test syntax of a path to a reference point if valid.
     void testPathSyntax(string, bool =false);
 
@@ -292,6 +630,9 @@ public:
     bool testGraphID(int);
 
 
+    // Evaluates an expression derived at limited depth, evaluating its GENERIC symbols first.
+    DoubleVector EvaluateLevel(const ex& expr, ParameterList& pl, DoubleVector& q, int depth, LaneValues& values);
+
     // Code for generating a symbolic Psi depending on various varforms
     ex getPsi(string myself, refPoint r1, refPoint r2, int varform);     
 